@@ -7,6 +7,7 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -214,6 +215,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
+	trace (TRACE_DISK_READ, TRACE_BEGIN, sec_no);
 	c = d->channel;
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
@@ -224,6 +226,7 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
 	input_sector (c, buffer);
 	d->read_cnt++;
 	lock_release (&c->lock);
+	trace (TRACE_DISK_READ, TRACE_END, sec_no);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -238,6 +241,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	ASSERT (d != NULL);
 	ASSERT (buffer != NULL);
 
+	trace (TRACE_DISK_WRITE, TRACE_BEGIN, sec_no);
 	c = d->channel;
 	lock_acquire (&c->lock);
 	select_sector (d, sec_no);
@@ -248,6 +252,7 @@ disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
 	sema_down (&c->completion_wait);
 	d->write_cnt++;
 	lock_release (&c->lock);
+	trace (TRACE_DISK_WRITE, TRACE_END, sec_no);
 }
 
 /* Disk detection and identification. */
@@ -24,24 +24,36 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* 8254 input frequency and its count for one timer tick, rounded
+   to nearest. */
+#define PIT_HZ 1193180
+#define PIT_TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* If true, the idle thread stops the periodic tick and programs
+   the 8254 to fire once at the next wakeup instead.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* One-shot state while the idle thread sleeps tickless. */
+static bool oneshot_armed;      /* Is the 8254 in one-shot mode? */
+static uint16_t oneshot_count;  /* Count it was programmed with. */
+static unsigned pit_residue;    /* 8254 counts not yet added to TICKS. */
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static void pit_set_periodic (void);
+static void pit_set_oneshot (uint16_t count);
+static uint16_t pit_read_count (void);
+static void oneshot_catch_up (unsigned elapsed);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
    corresponding interrupt. */
 void
 timer_init (void) {
-	/* 8254 input frequency divided by TIMER_FREQ, rounded to
-	   nearest. */
-	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
-
-	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-	outb (0x40, count & 0xff);
-	outb (0x40, count >> 8);
-
+	pit_set_periodic ();
 	intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -130,12 +142,88 @@ timer_print_stats (void) {
 	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  In tickless mode, replaces the periodic tick with a
+   one-shot interrupt at the next thread wakeup, or as far ahead
+   as the 16-bit 8254 counter reaches (about 55 ms).
+
+   MLFQS needs load_avg and recent_cpu updated on exact tick
+   boundaries, so tickless mode is ignored when it is active. */
+void
+timer_idle_enter (void) {
+	int64_t delta;
+	unsigned partial;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!timer_tickless || thread_mlfqs || oneshot_armed)
+		return;
+
+	delta = get_next_tick_to_awake () - ticks;
+	if (delta <= 1)
+		return;
+	if (delta > UINT16_MAX / PIT_TICK_COUNT)
+		delta = UINT16_MAX / PIT_TICK_COUNT;
+
+	/* Part of the current tick period has elapsed already.  Carry
+	   it in pit_residue and shorten the one-shot to match, so that
+	   it fires exactly on a tick boundary. */
+	partial = PIT_TICK_COUNT - pit_read_count ();
+	pit_residue += partial;
+	oneshot_count = delta * PIT_TICK_COUNT - partial;
+	oneshot_armed = true;
+	pit_set_oneshot (oneshot_count);
+}
+
+/* Called by schedule(), with interrupts off, whenever it switches
+   away from the idle thread.  If an interrupt other than the timer
+   ended the idle sleep, brings TICKS up to date and restarts the
+   periodic tick, so that time slices and timer_sleep() deadlines
+   never run on a frozen TICKS. */
+void
+timer_idle_exit (void) {
+	uint16_t remaining;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (!oneshot_armed)
+		return;
+
+	/* In mode 0 the counter keeps counting down past zero, so a
+	   count above the programmed one means the one-shot already
+	   fired.  Its interrupt is pending and timer_interrupt() will
+	   do the catch-up. */
+	remaining = pit_read_count ();
+	if (remaining > oneshot_count)
+		return;
+
+	oneshot_catch_up (oneshot_count - remaining);
+}
+
+/* Adds ELAPSED 8254 counts of one-shot sleep to TICKS and goes
+   back to periodic mode.  Whole ticks are added right away; the
+   remainder is carried in pit_residue, so TICKS never runs ahead
+   of real time and never loses time across idle periods. */
+static void
+oneshot_catch_up (unsigned elapsed) {
+	pit_residue += elapsed;
+	ticks += pit_residue / PIT_TICK_COUNT;
+	pit_residue %= PIT_TICK_COUNT;
+	oneshot_armed = false;
+	pit_set_periodic ();
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
-	ticks++;
+	if (oneshot_armed)
+		oneshot_catch_up (oneshot_count);
+	else
+		ticks++;
 	thread_tick ();
 
+	/* MLFQS recent_cpu, priority and load_avg updates. */
+	if (thread_mlfqs)
+		mlfqs_tick (ticks);
+
 	/* --------- project 1 --------- */
 	int64_t next_tick;
 	next_tick = get_next_tick_to_awake();
@@ -148,6 +236,37 @@ timer_interrupt (struct intr_frame *args UNUSED) {
 	/* ----------------------------- */
 }
 
+/* Puts counter 0 of the 8254 in rate generator mode, interrupting
+   TIMER_FREQ times per second. */
+static void
+pit_set_periodic (void) {
+	uint16_t count = PIT_TICK_COUNT;
+
+	outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Makes counter 0 of the 8254 interrupt once, COUNT input clocks
+   from now. */
+static void
+pit_set_oneshot (uint16_t count) {
+	outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+	outb (0x40, count & 0xff);
+	outb (0x40, count >> 8);
+}
+
+/* Returns the current value of counter 0 of the 8254. */
+static uint16_t
+pit_read_count (void) {
+	uint8_t lo, hi;
+
+	outb (0x43, 0x00);    /* CW: latch counter 0. */
+	lo = inb (0x40);
+	hi = inb (0x40);
+	return lo | (hi << 8);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
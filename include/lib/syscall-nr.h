@@ -36,6 +36,12 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Scheduling statistics. */
+	SYS_THREAD_STATS,           /* Snapshot per-thread scheduling statistics. */
+
+	/* Scheduling. */
+	SYS_YIELD,                  /* Give up the CPU. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,43 @@
+#ifndef __LIB_THREAD_STATS_H
+#define __LIB_THREAD_STATS_H
+
+#include <stdint.h>
+
+/* Binary snapshot of per-thread scheduling statistics, as filled
+   in by the thread_stats() system call.  Shared by the kernel and
+   user programs.
+
+   The snapshot is a struct thread_stats_header followed by
+   RECORD_CNT records of RECORD_SIZE bytes each.  All times are in
+   timer ticks. */
+
+#define THREAD_STATS_MAGIC 0x54535453   /* "STST". */
+
+struct thread_stats_header {
+	uint32_t magic;             /* THREAD_STATS_MAGIC. */
+	uint32_t record_size;       /* sizeof (struct thread_stats_record). */
+	uint32_t record_cnt;        /* Number of records that follow. */
+	uint32_t thread_cnt;        /* Threads alive, may exceed record_cnt. */
+	int64_t ticks;              /* Timer ticks when taken. */
+};
+
+/* Counters kept for every thread. */
+struct thread_stats {
+	int64_t run_ticks;              /* Ticks spent running. */
+	int64_t ready_ticks;            /* Ticks spent in the ready queue. */
+	int64_t lock_wait_ticks;        /* Ticks spent waiting in lock_acquire(). */
+	int64_t voluntary_switches;     /* Times it blocked or yielded. */
+	int64_t involuntary_switches;   /* Times it was switched out while runnable. */
+	int64_t donations;              /* Times a donation raised its priority. */
+};
+
+struct thread_stats_record {
+	int32_t tid;                /* Thread identifier. */
+	int32_t status;             /* enum thread_status. */
+	int32_t priority;           /* Effective priority. */
+	int32_t nice;               /* Niceness (MLFQS). */
+	char name[16];              /* Thread name, null-terminated. */
+	struct thread_stats stats;
+};
+
+#endif /* lib/thread-stats.h */
@@ -38,6 +38,12 @@ void close (int fd);
 
 int dup2(int oldfd, int newfd);
 
+/* Scheduling statistics, see <thread-stats.h>. */
+int thread_stats (void *buffer, unsigned size);
+
+/* Scheduling. */
+void yield (void);
+
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
@@ -0,0 +1,36 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* 17.14 fixed-point real numbers for the MLFQS scheduler.
+ *
+ * A real number x is stored as the int x * FP_F.  N is an integer,
+ * X and Y are fixed-point numbers.  Products and quotients of two
+ * fixed-point numbers go through int64_t so the intermediate
+ * value does not overflow. */
+typedef int fixed_t;
+
+#define FP_F (1 << 14)
+
+static inline fixed_t int_to_fp (int n) { return n * FP_F; }
+static inline int fp_to_int (fixed_t x) { return x / FP_F; }
+static inline int fp_to_int_round (fixed_t x) {
+	return x >= 0 ? (x + FP_F / 2) / FP_F : (x - FP_F / 2) / FP_F;
+}
+
+static inline fixed_t add_fp (fixed_t x, fixed_t y) { return x + y; }
+static inline fixed_t sub_fp (fixed_t x, fixed_t y) { return x - y; }
+static inline fixed_t add_mixed (fixed_t x, int n) { return x + n * FP_F; }
+static inline fixed_t sub_mixed (fixed_t x, int n) { return x - n * FP_F; }
+
+static inline fixed_t mult_fp (fixed_t x, fixed_t y) {
+	return (fixed_t) (((int64_t) x) * y / FP_F);
+}
+static inline fixed_t mult_mixed (fixed_t x, int n) { return x * n; }
+static inline fixed_t div_fp (fixed_t x, fixed_t y) {
+	return (fixed_t) (((int64_t) x) * FP_F / y);
+}
+static inline fixed_t div_mixed (fixed_t x, int n) { return x / n; }
+
+#endif /* threads/fixed_point.h */
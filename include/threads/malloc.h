@@ -3,11 +3,26 @@
 
 #include <debug.h>
 #include <stddef.h>
+#include <stdint.h>
+
+/* Number of block size classes. */
+#define MALLOC_CLASSES 12
+
+/* A thread's cache of blocks it recently freed: a stack of blocks,
+   linked through their first word, for each size class.  The
+   blocks of a stack all lie in the same arena.  Only the owning
+   thread touches it, so it needs no locking. */
+struct malloc_cache {
+	void *blocks[MALLOC_CLASSES];       /* Top of each stack. */
+	uint8_t cnt[MALLOC_CLASSES];        /* Blocks in each stack. */
+};
 
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+void malloc_thread_exit (void);
+void malloc_print_stats (void);
 
 #endif /* threads/malloc.h */
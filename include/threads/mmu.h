@@ -8,6 +8,8 @@
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
+uint64_t *pml4e_walk_pde (uint64_t *pml4, const uint64_t va, int create);
+void tlb_init (void);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
 void pml4_destroy (uint64_t *pml4);
@@ -19,6 +21,13 @@ bool pml4_is_dirty (uint64_t *pml4, const void *upage);
 void pml4_set_dirty (uint64_t *pml4, const void *upage, bool dirty);
 bool pml4_is_accessed (uint64_t *pml4, const void *upage);
 void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
+void pml4_set_writable (uint64_t *pml4, const void *upage, bool writable);
+
+/* Control register bits used by tlb_init() and pml4_activate(). */
+#define CR4_PGE (1UL << 7)          /* Global pages. */
+#define CR4_PCIDE (1UL << 17)       /* Process-context identifiers. */
+#define CR3_PCID_MASK 0xfffUL       /* PCID in the low bits of CR3. */
+#define CR3_NOFLUSH (1UL << 63)     /* Keep the PCID's TLB entries. */
 
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
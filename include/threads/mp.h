@@ -0,0 +1,49 @@
+#ifndef THREADS_MP_H
+#define THREADS_MP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Multiprocessor bring-up.
+ *
+ * mp_init() reads the Intel MultiProcessor Specification tables
+ * that the BIOS leaves in low memory (QEMU lists one processor per
+ * `pintos --cpus N') and maps the local APIC.  mp_start_aps() then
+ * wakes each application processor (AP) with an INIT and two
+ * STARTUP IPIs.  An AP comes up through the real-mode trampoline in
+ * start.S, switches to base_pml4 and to the stack of an idle thread
+ * of its own, and parks there with interrupts off.
+ *
+ * Only the bootstrap processor (BSP) schedules threads.  The run
+ * queues and everything else that relies on intr_disable() for
+ * mutual exclusion cannot be shared between running CPUs until they
+ * are protected by spinlocks, so code that sizes per-CPU state must
+ * not assume that mp_cpu_started processors take work. */
+
+/* Most processors we keep track of. */
+#define MP_MAX_CPUS 8
+
+/* A processor. */
+struct cpu {
+	int id;                     /* Index in cpus[]; the BSP is 0. */
+	uint8_t lapic_id;           /* Local APIC ID. */
+	volatile bool started;      /* Running kernel code yet? */
+	struct thread *idle;        /* Idle thread, run when nothing else is. */
+	struct thread *curr;        /* Thread running on this CPU. */
+};
+
+/* Processors listed in the MP tables, the BSP first. */
+extern struct cpu cpus[MP_MAX_CPUS];
+
+/* Number of processors in cpus[], at least 1. */
+extern size_t mp_cpu_cnt;
+
+/* Number of processors that have started, at least 1. */
+extern size_t mp_cpu_started;
+
+void mp_init (void);
+void mp_start_aps (void);
+struct cpu *cpu_current (void);
+
+#endif /* threads/mp.h */
@@ -1,13 +1,14 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
 
 /* A counting semaphore. */
 struct semaphore {
 	unsigned value;             /* Current value. */
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* Waiting threads, highest priority on top. */
 };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -20,9 +21,16 @@ void sema_self_test (void);
 struct lock {
 	struct thread *holder;      /* Thread holding lock (for debugging). */
 	struct semaphore semaphore; /* Binary semaphore controlling access. */
+	bool adaptive;              /* Try to wait out a preempted holder first? */
+	struct heap donors;         /* Waiting threads, highest priority on top. */
+	struct heap_elem holder_elem; /* Element in holder's held_locks. */
 };
 
+/* Number of times an adaptive lock retries before it sleeps. */
+#define LOCK_SPIN_CNT 8
+
 void lock_init (struct lock *);
+void lock_init_adaptive (struct lock *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -30,7 +38,7 @@ bool lock_held_by_current_thread (const struct lock *);
 
 /* Condition variable. */
 struct condition {
-	struct list waiters;        /* List of waiting threads. */
+	struct heap waiters;        /* struct semaphore_elem, highest priority on top. */
 };
 
 void cond_init (struct condition *);
@@ -38,8 +46,43 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Reader-writer lock.  Any number of readers or a single writer
+   may hold it at a time.  Waiting writers are preferred over new
+   readers of equal or lower priority, and a waiting thread
+   donates its priority to every current holder. */
+struct rwlock {
+	int readers;                /* # of threads holding it for reading. */
+	struct thread *writer;      /* Thread holding it for writing, or NULL. */
+	struct list holds;          /* struct rw_hold of every current holder. */
+	struct heap read_waiters;   /* Waiting readers, highest priority on top. */
+	struct heap write_waiters;  /* Waiting writers, highest priority on top. */
+};
+
+/* One thread's hold on a reader-writer lock, supplied by the
+   caller of rw_read_acquire() or rw_write_acquire() and usually
+   kept on its stack until the matching rw_release().  Sits on one
+   of the lock's waiter heaps while the thread waits, then on
+   rw->holds, so that a waiting writer can find every reader it
+   has to donate to, and on its thread's rw_holds. */
+struct rw_hold {
+	struct rwlock *rw;          /* Lock held or waited for. */
+	struct thread *thread;      /* Thread holding it. */
+	bool write;                 /* Held for writing? */
+	struct list_elem elem;      /* Element in rw->holds. */
+	struct heap_elem wait_elem; /* Element in a waiter heap of rw. */
+	struct heap_elem thread_elem; /* Element in thread->rw_holds. */
+};
+
+void rw_init (struct rwlock *);
+void rw_read_acquire (struct rwlock *, struct rw_hold *);
+void rw_write_acquire (struct rwlock *, struct rw_hold *);
+void rw_release (struct rwlock *, struct rw_hold *);
+
 /* ----------------- project 1 ----------------- */
-static bool cmp_sem_priority(const struct list_elem *a, const struct list_elem *b, void *aux);
+void sema_waiter_update(struct thread *t);
+bool held_lock_more(const struct heap_elem *a, const struct heap_elem *b, void *aux);
+bool rw_hold_more(const struct heap_elem *a, const struct heap_elem *b, void *aux);
+void refresh_priority(void);
 /* --------------------------------------------- */
 
 /* Optimization barrier.
@@ -3,8 +3,10 @@
 #define USERPROG
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
+#include <thread-stats.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
@@ -30,6 +32,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the MLFQS scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /* ------------------ project2 -------------------- */
 #define FDT_PAGES 3		/* pages to allocate for file descriptor tables (thread_create, process_exit) */
 #define FDCOUNT_LIMIT FDT_PAGES *(1 << 9)		/* limit fd_idx */
@@ -136,16 +143,38 @@ struct thread {
 
 	/* ----- PROJECT 1 --------- */
 	int64_t wake_up_tick; /* thread's wakeup_time */
+	struct heap_elem sleep_elem; /* element in sleep_heap (thread.c) */
 	int initial_priority; /* thread's initial priority */
 	// 깨어나야할 tick 저장 (Alarm Clock - wakeup_tick)
 	struct lock *wait_on_lock; /* which lock thread is waiting for  */
-	// 자신에게 priority를 donate한 스레드의 리스트
-	struct list donation_list; /* list of threads that donate priority to **this thread** */
-	// priority를 donate한 스레드들의 리스트를 관리하기 위한 element.
-	// 이 element를 통해 자신이 우선 순위를 donate한 스레드의 donations 리스트에 연결된다.
-	struct list_elem donation_elem; /* prev and next pointer of donation_list where **this thread donate** */
+	// 자신이 가진 lock들. 각 lock에서 기다리는 스레드 중 가장 높은 priority 순으로 정렬된다.
+	struct heap held_locks; /* locks held by **this thread**, by best donor first (synch.c) */
+	// 자신이 기다리는 lock의 donors heap에 연결된다.
+	struct heap_elem donor_elem; /* element in wait_on_lock->donors where **this thread donate** */
+	struct semaphore *wait_on_sema; /* semaphore this thread is blocked on */
+	struct heap_elem sema_elem; /* element in wait_on_sema->waiters */
+	struct semaphore_elem *cond_waiter; /* entry in the condition variable this thread waits for (synch.c) */
+	struct heap rw_holds; /* struct rw_hold of reader-writer locks held, by best donor first (synch.c) */
+	struct rw_hold *wait_on_rw; /* hold this thread is waiting to be granted (synch.c) */
+
+	/* MLFQS (-mlfqs) */
+	int nice;                       /* niceness, NICE_MIN..NICE_MAX */
+	int recent_cpu;                 /* 17.14 fixed-point, see fixed_point.h */
+	bool mlfqs_dirty;               /* recent_cpu changed since last priority update */
+	struct list_elem dirty_elem;    /* element in mlfqs_dirty_list (thread.c) */
+	struct list_elem all_elem;      /* element in all_list (thread.c) */
 	/* ------------------------- */
 
+	int rq;                         /* home run queue, soft affinity (thread.c) */
+	uint64_t ready_seq;             /* when it last became ready, orders run queues (thread.c) */
+
+	/* Scheduling statistics (thread_stats syscall) */
+	struct thread_stats stats;      /* see lib/thread-stats.h */
+	int64_t ready_since;            /* tick this thread last became ready */
+	bool yielding;                  /* in thread_yield(), switch is voluntary */
+
+	struct malloc_cache *malloc_cache; /* recently freed blocks, or NULL (malloc.c) */
+
 	/* ---------- Project 2 ---------- */
 	int exit_status;	 	/* to give child exit_status to parent */
 	int fd_idx;					// fd table에 open spot의 index
@@ -167,6 +196,7 @@ struct thread {
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
 	struct supplemental_page_table spt;
+	void *user_rsp;                     /* User rsp on entry to a syscall. */
 #endif
 
 	/* Owned by thread.c. */
@@ -188,6 +218,7 @@ void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+struct thread *thread_alloc_idle (const char *name);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -198,6 +229,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
@@ -220,7 +252,11 @@ int64_t get_next_tick_to_awake(void);
 
 bool cmp_priority(struct list_elem *element1, struct list_elem *element2, void *aux);
 bool preempt_by_priority(void);
-bool thread_donate_priority_compare (struct list_elem *element1, struct list_elem *element2, void *aux);
+void thread_change_priority(struct thread *t, int priority);
+void mlfqs_tick(int64_t ticks);
+int thread_stats_snapshot(void *buffer, size_t size);
+int thread_rq_count(void);
+int64_t thread_rq_busy_ticks(int rq);
 /* ------------------------------------- */
 /* ------------------- project 2 -------------------- */
 struct thread* get_child_by_tid(tid_t tid);
@@ -0,0 +1,73 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+ *
+ * With -trace on the kernel command line, the kernel records
+ * timestamped events into a fixed-size ring buffer, overwriting the
+ * oldest events once it is full.  Recording an event only disables
+ * interrupts for a moment and never prints, so it does not disturb
+ * timing the way printf() does.  Without -trace each trace point
+ * costs a single test of trace_enabled.
+ *
+ * The buffer can be printed over the serial port with the
+ * `trace-dump' action, or saved into the file system with
+ * `trace-save FILE' and fetched with `pintos -g FILE'.
+ * utils/pintos-trace turns either form into a timeline. */
+
+/* Event types.  Keep in sync with utils/pintos-trace. */
+enum trace_type {
+	TRACE_SCHEDULE,             /* schedule() picked a thread, ARG = its tid. */
+	TRACE_LAUNCH,               /* thread_launch() switches, ARG = new tid. */
+	TRACE_INTR,                 /* intr_handler(), ARG = vector number. */
+	TRACE_SYSCALL,              /* syscall_handler(), ARG = syscall number. */
+	TRACE_DISK_READ,            /* disk_read(), ARG = sector. */
+	TRACE_DISK_WRITE,           /* disk_write(), ARG = sector. */
+	TRACE_PAGE_FAULT,           /* page_fault(), ARG = fault address. */
+};
+
+/* Whether an event starts or ends an interval, or is a single point. */
+enum trace_phase {
+	TRACE_BEGIN,
+	TRACE_END,
+	TRACE_MARK,
+};
+
+/* One recorded event.  This is also the on-disk format. */
+struct trace_event {
+	uint64_t tsc;               /* Time stamp counter. */
+	uint64_t arg;               /* Depends on TYPE. */
+	int32_t tid;                /* Thread running at the time. */
+	uint16_t type;              /* enum trace_type. */
+	uint16_t phase;             /* enum trace_phase. */
+};
+
+/* Header of a saved or dumped trace, followed by EVENT_CNT events
+   in the order they were recorded. */
+#define TRACE_MAGIC 0x43525450  /* "PTRC". */
+struct trace_header {
+	uint32_t magic;             /* TRACE_MAGIC. */
+	uint32_t event_size;        /* sizeof (struct trace_event). */
+	uint64_t event_cnt;         /* Events that follow. */
+	uint64_t dropped_cnt;       /* Older events overwritten. */
+	uint64_t tsc_hz;            /* Time stamp counter frequency. */
+};
+
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_record (enum trace_type, enum trace_phase, uint64_t arg);
+void trace_dump (char **argv);
+void trace_save (char **argv);
+
+/* Records an event of TYPE and PHASE with ARG, if tracing is on. */
+static inline void
+trace (enum trace_type type, enum trace_phase phase, uint64_t arg) {
+	if (trace_enabled)
+		trace_record (type, phase, arg);
+}
+
+#endif /* threads/trace.h */
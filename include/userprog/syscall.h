@@ -4,7 +4,7 @@
 void syscall_init (void);
 
 /* -------- project2 ---------- */
-struct lock filesys_lock;   /* proventing race condition against  */
+extern struct lock filesys_lock;   /* proventing race condition against  */
 /* ---------------------------- */
 
 #endif /* userprog/syscall.h */
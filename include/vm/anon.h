@@ -1,13 +1,24 @@
 #ifndef VM_ANON_H
 #define VM_ANON_H
+#include <stddef.h>
 #include "vm/vm.h"
 struct page;
 enum vm_type;
 
+/* No swap slot. */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
 struct anon_page {
+	/* Swap slot holding the page's contents, or SWAP_SLOT_NONE.  The
+	 * slot is kept after the page is swapped back in, so that if the
+	 * page is not written to again it can be evicted without I/O.
+	 * Pages forked from one another may share a slot. */
+	size_t slot;
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_share_slot (struct page *dst, struct page *src);
+void anon_print_stats (void);
 
 #endif
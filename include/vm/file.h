@@ -7,10 +7,30 @@ struct page;
 enum vm_type;
 
 struct file_page {
+	struct file *file;     /* Own handle on the mapped file. */
+	off_t ofs;             /* Offset of the page in FILE. */
+	size_t read_bytes;     /* Bytes of FILE in the page, rest is zeros. */
+	void *mapping;         /* Start of the mmap()ed region. */
+};
+
+/* Where the contents of a page that is loaded lazily come from:
+ * READ_BYTES bytes of FILE at offset OFS, then ZERO_BYTES zeros.
+ * Used as the AUX of every initializer in this tree.  It belongs
+ * to the page, which owns FILE too: the initializer frees it once
+ * it has run, and uninit_destroy() frees it if it never does. */
+struct file_segment {
+	struct file *file;
+	off_t ofs;
+	size_t read_bytes;
+	size_t zero_bytes;
+	void *mapping;         /* Start of the mmap()ed region, or null. */
 };
 
 void vm_file_init (void);
+struct file_segment *file_segment_dup (const struct file_segment *seg);
+void file_segment_free (struct file_segment *seg);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+bool file_backed_dup (struct page *src);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
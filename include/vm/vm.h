@@ -1,6 +1,7 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
 #include "threads/palloc.h"
 
 enum vm_type {
@@ -20,6 +21,9 @@ enum vm_type {
 	VM_MARKER_0 = (1 << 3),
 	VM_MARKER_1 = (1 << 4),
 
+	/* Page is part of the user stack. */
+	VM_STACK = VM_MARKER_0,
+
 	/* DO NOT EXCEED THIS VALUE. */
 	VM_MARKER_END = (1 << 31),
 };
@@ -46,6 +50,12 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+#ifndef SPT_RADIX
+	struct hash_elem spt_elem;  /* Element in the owner's SPT. */
+#endif
+	bool writable;         /* May the user process write to it? */
+	struct thread *owner;  /* Process whose page table maps it. */
+	struct list_elem frame_elem;  /* Element in the frame's pages. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -59,10 +69,15 @@ struct page {
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame".  After a fork, several pages may
+ * share a frame copy-on-write, mapped read-only, until one of them
+ * is written to. */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct list pages;      /* Pages that map the frame. */
+	unsigned ref_cnt;       /* Number of pages in PAGES. */
+	bool busy;              /* Being written out by the evictor. */
+	struct list_elem elem;  /* Element in the frame table. */
 };
 
 /* The function table for page operations.
@@ -85,8 +100,17 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
+#ifdef SPT_RADIX
+	void *root;            /* Top node of the radix tree, or null. */
+#else
+	struct hash pages;     /* struct page, keyed by va. */
+#endif
 };
 
+/* Called by spt_for_each() for each page.  Returning false stops
+ * the walk. */
+typedef bool spt_for_each_func (struct page *, void *aux);
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
@@ -96,10 +120,13 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_for_each (struct supplemental_page_table *spt,
+		spt_for_each_func *func, void *aux);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
+bool vm_is_stack_access (const void *addr, const void *rsp);
 
 #define vm_alloc_page(type, upage, writable) \
 	vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
@@ -108,5 +135,6 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
+void vm_print_stats (void);
 
 #endif  /* VM_VM_H */
@@ -0,0 +1,186 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* A pairing heap is a tree with the least element at the root.
+   Each node keeps only a pointer to its leftmost child; the
+   children of a node are chained through `next' and `prev'.  The
+   `prev' pointer of a leftmost child points to its parent, which
+   is what lets heap_remove() unlink an arbitrary element.
+
+   Two trees are combined ("melded") by making the root that
+   loses the comparison the new leftmost child of the other, so
+   insertion is a single meld.  Removing the root leaves a list
+   of subtrees that are melded back together in two passes: first
+   left to right in pairs, then the pairs right to left.  This is
+   what gives the O(log n) amortized bound. */
+
+/* Returns true if A must come out of heap H before B. */
+static inline bool
+before (const struct heap *h, const struct heap_elem *a,
+		const struct heap_elem *b) {
+	if (h->less (a, b, h->aux))
+		return true;
+	if (h->less (b, a, h->aux))
+		return false;
+	return a->seq < b->seq;
+}
+
+/* Melds the trees rooted at A and B, which must not have
+   siblings, and returns the new root. */
+static struct heap_elem *
+meld (const struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	struct heap_elem *t;
+
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (before (h, b, a)) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	/* B becomes the leftmost child of A. */
+	b->prev = a;
+	b->next = a->child;
+	if (a->child != NULL)
+		a->child->prev = b;
+	a->child = b;
+	return a;
+}
+
+/* Melds the sibling list that starts at FIRST into a single tree
+   and returns its root, or NULL if FIRST is NULL. */
+static struct heap_elem *
+merge_pairs (const struct heap *h, struct heap_elem *first) {
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	/* First pass: meld siblings in pairs, left to right, pushing
+	   each result onto a stack linked through `next'. */
+	while (first != NULL) {
+		struct heap_elem *a = first;
+		struct heap_elem *b = a->next;
+
+		first = b != NULL ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if (b != NULL) {
+			b->next = b->prev = NULL;
+			a = meld (h, a, b);
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	/* Second pass: meld the pairs together, right to left. */
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (h, root, pairs);
+		pairs = next;
+	}
+	return root;
+}
+
+/* Initializes heap H as an empty heap ordered by LESS given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->elem_cnt = 0;
+	h->next_seq = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Links E, whose `seq' is already set, into H. */
+static void
+insert (struct heap *h, struct heap_elem *e) {
+	e->child = e->next = e->prev = NULL;
+	h->root = meld (h, h->root, e);
+	h->elem_cnt++;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->seq = h->next_seq++;
+	insert (h, e);
+}
+
+/* Removes the least element from H and returns it.
+   H must not be empty. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *top;
+
+	ASSERT (!heap_empty (h));
+
+	top = h->root;
+	h->root = merge_pairs (h, top->child);
+	h->elem_cnt--;
+	top->child = NULL;
+	return top;
+}
+
+/* Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	if (e == h->root) {
+		heap_pop (h);
+		return;
+	}
+
+	/* Unlink E, together with its subtree, from its siblings. */
+	if (e->prev->child == e)
+		e->prev->child = e->next;
+	else
+		e->prev->next = e->next;
+	if (e->next != NULL)
+		e->next->prev = e->prev;
+
+	h->root = meld (h, h->root, merge_pairs (h, e->child));
+	h->elem_cnt--;
+	e->child = e->next = e->prev = NULL;
+}
+
+/* Restores the heap order after the value of E, which must be in
+   H, has changed.  E keeps its place among equal elements. */
+void
+heap_update (struct heap *h, struct heap_elem *e) {
+	heap_remove (h, e);
+	insert (h, e);
+}
+
+/* Returns the least element in H without removing it, or a null
+   pointer if H is empty. */
+struct heap_elem *
+heap_top (const struct heap *h) {
+	ASSERT (h != NULL);
+	return h->root;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h) {
+	ASSERT (h != NULL);
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+heap_empty (const struct heap *h) {
+	ASSERT (h != NULL);
+	return h->root == NULL;
+}
@@ -146,6 +146,16 @@ dup2 (int oldfd, int newfd){
 	return syscall2 (SYS_DUP2, oldfd, newfd);
 }
 
+int
+thread_stats (void *buffer, unsigned size) {
+	return syscall2 (SYS_THREAD_STATS, buffer, size);
+}
+
+void
+yield (void) {
+	syscall0 (SYS_YIELD);
+}
+
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
 	return (void *) syscall5 (SYS_MMAP, addr, length, writable, fd, offset);
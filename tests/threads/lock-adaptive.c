@@ -0,0 +1,110 @@
+/* Measures lock_acquire() latency for a plain lock and for an
+   adaptive lock (see lock_init_adaptive()), first without
+   contention and then with several threads of equal priority
+   fighting over the lock.
+
+   To model a holder being preempted in the middle of a short
+   critical section, every few iterations the holder yields while
+   it still owns the lock.  A plain lock puts every other thread
+   to sleep at that point; an adaptive lock lets them yield back
+   to the holder instead.
+
+   Timings are printed in timer ticks and are informational only.
+   The test checks that both kinds of lock still provide mutual
+   exclusion. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define UNCONTENDED_ITERS 200000
+#define THREAD_CNT 4
+#define CONTENDED_ITERS 5000
+#define YIELD_EVERY 8
+
+struct lock_bench 
+  {
+    struct lock lock;           /* Lock under test. */
+    struct semaphore done;      /* Upped by each finished thread. */
+    int counter;                /* Protected by LOCK. */
+  };
+
+static thread_func contender;
+static void bench (const char *name, bool adaptive);
+
+void
+test_lock_adaptive (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  bench ("plain", false);
+  bench ("adaptive", true);
+}
+
+static void
+bench (const char *name, bool adaptive) 
+{
+  struct lock_bench b;
+  int64_t start;
+  int i;
+
+  if (adaptive)
+    lock_init_adaptive (&b.lock);
+  else
+    lock_init (&b.lock);
+  sema_init (&b.done, 0);
+  b.counter = 0;
+
+  /* Uncontended. */
+  start = timer_ticks ();
+  for (i = 0; i < UNCONTENDED_ITERS; i++) 
+    {
+      lock_acquire (&b.lock);
+      lock_release (&b.lock);
+    }
+  msg ("%s lock, uncontended: %d acquires in %"PRId64" ticks.",
+       name, UNCONTENDED_ITERS, timer_elapsed (start));
+
+  /* Contended. */
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char thread_name[16];
+      snprintf (thread_name, sizeof thread_name, "contender %d", i);
+      thread_create (thread_name, PRI_DEFAULT, contender, &b);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&b.done);
+  msg ("%s lock, %d threads contended: %d acquires in %"PRId64" ticks.",
+       name, THREAD_CNT, THREAD_CNT * CONTENDED_ITERS, timer_elapsed (start));
+
+  if (b.counter != THREAD_CNT * CONTENDED_ITERS)
+    fail ("%s lock: counter is %d, expected %d.",
+          name, b.counter, THREAD_CNT * CONTENDED_ITERS);
+  msg ("%s lock: mutual exclusion held.", name);
+}
+
+static void
+contender (void *b_) 
+{
+  struct lock_bench *b = b_;
+  int i;
+
+  for (i = 0; i < CONTENDED_ITERS; i++) 
+    {
+      int old;
+
+      lock_acquire (&b->lock);
+      old = b->counter;
+      if (i % YIELD_EVERY == 0)
+        thread_yield ();
+      b->counter = old + 1;
+      lock_release (&b->lock);
+    }
+  sema_up (&b->done);
+}
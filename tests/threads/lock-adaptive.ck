@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Blank out the tick counts, which depend on the machine.
+s/ in \d+ ticks\.$/ in N ticks./ foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(lock-adaptive) begin
+(lock-adaptive) plain lock, uncontended: 200000 acquires in N ticks.
+(lock-adaptive) plain lock, 4 threads contended: 20000 acquires in N ticks.
+(lock-adaptive) plain lock: mutual exclusion held.
+(lock-adaptive) adaptive lock, uncontended: 200000 acquires in N ticks.
+(lock-adaptive) adaptive lock, 4 threads contended: 20000 acquires in N ticks.
+(lock-adaptive) adaptive lock: mutual exclusion held.
+(lock-adaptive) end
+EOF
+pass;
@@ -0,0 +1,125 @@
+/* Benchmarks the page allocator.
+
+   Times ROUNDS rounds of three patterns, in time stamp counter
+   cycles per page:
+
+     - "single": allocate and free one page at a time, the pattern
+       of thread stacks and page tables;
+
+     - "burst": allocate BURST pages one at a time, then free them
+       all, which goes through the pool bitmap whenever a burst runs
+       past what is cached in front of it;
+
+     - "multiple": allocate and free two contiguous pages at a time,
+       with FILL pages held so that the free pages are not all at the
+       start of the pool.
+
+   Uses only the palloc_*() interface, so the same test can be run
+   against older page allocators to compare.  Timings are
+   informational only; the test checks that every allocation
+   succeeded. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "intrinsic.h"
+
+#define ROUNDS 2000
+#define BURST 100
+#define FILL 200
+
+static void *burst[BURST];
+static void *fill[FILL];
+
+static uint64_t bench_single (enum palloc_flags);
+static uint64_t bench_burst (enum palloc_flags);
+static uint64_t bench_multiple (enum palloc_flags);
+
+void
+test_palloc_latency (void) 
+{
+  static const struct 
+    {
+      const char *name;
+      enum palloc_flags flags;
+    }
+  pools[] = {{"kernel", 0}, {"user", PAL_USER}};
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++) 
+    {
+      enum palloc_flags flags = pools[i].flags;
+
+      msg ("%s pool: single %"PRIu64" cycles/page, burst %"PRIu64
+           " cycles/page, multiple %"PRIu64" cycles/page.",
+           pools[i].name, bench_single (flags), bench_burst (flags),
+           bench_multiple (flags));
+    }
+  msg ("all allocations succeeded.");
+}
+
+static uint64_t
+bench_single (enum palloc_flags flags) 
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      void *page = palloc_get_page (flags);
+      if (page == NULL)
+        fail ("palloc_get_page failed in round %d", i);
+      palloc_free_page (page);
+    }
+  return (rdtsc () - start) / ROUNDS;
+}
+
+static uint64_t
+bench_burst (enum palloc_flags flags) 
+{
+  uint64_t start = rdtsc ();
+  int i, j;
+
+  for (i = 0; i < ROUNDS / 10; i++) 
+    {
+      for (j = 0; j < BURST; j++) 
+        {
+          burst[j] = palloc_get_page (flags);
+          if (burst[j] == NULL)
+            fail ("palloc_get_page failed in round %d", i);
+        }
+      for (j = 0; j < BURST; j++)
+        palloc_free_page (burst[j]);
+    }
+  return (rdtsc () - start) / (ROUNDS / 10 * BURST);
+}
+
+static uint64_t
+bench_multiple (enum palloc_flags flags) 
+{
+  uint64_t start, cycles;
+  int i;
+
+  for (i = 0; i < FILL; i++) 
+    {
+      fill[i] = palloc_get_page (flags);
+      if (fill[i] == NULL)
+        fail ("palloc_get_page failed while filling");
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      void *pages = palloc_get_multiple (flags, 2);
+      if (pages == NULL)
+        fail ("palloc_get_multiple failed in round %d", i);
+      palloc_free_multiple (pages, 2);
+    }
+  cycles = (rdtsc () - start) / (ROUNDS * 2);
+
+  for (i = 0; i < FILL; i++)
+    palloc_free_page (fill[i]);
+  return cycles;
+}
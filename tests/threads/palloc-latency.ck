@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Cycle counts differ between machines and runs.
+s/\d+ cycles\/page/N cycles\/page/g foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-latency) begin
+(palloc-latency) kernel pool: single N cycles/page, burst N cycles/page, multiple N cycles/page.
+(palloc-latency) user pool: single N cycles/page, burst N cycles/page, multiple N cycles/page.
+(palloc-latency) all allocations succeeded.
+(palloc-latency) end
+EOF
+pass;
@@ -0,0 +1,77 @@
+/* Tests that cond_signal() goes by the priority a waiter has now,
+   not the one it had when it called cond_wait().
+
+   Thread "low" calls cond_wait() while thread "high" is waiting
+   for the lock it passes, so low joins the waiters with high's
+   donated priority.  Releasing the lock inside cond_wait() drops
+   low back below thread "mid", which was already waiting, so the
+   first signal must wake mid. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func waiter_thread;
+static thread_func low_thread;
+static thread_func high_thread;
+static struct lock lock;
+static struct condition condition;
+static struct semaphore go;
+
+void
+test_priority_condvar_donate (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&lock);
+  cond_init (&condition);
+  sema_init (&go, 0);
+
+  thread_create ("mid", PRI_DEFAULT + 5, waiter_thread, NULL);
+  thread_create ("low", PRI_DEFAULT + 1, low_thread, NULL);
+  thread_create ("high", PRI_DEFAULT + 10, high_thread, NULL);
+  sema_up (&go);
+
+  for (i = 0; i < 2; i++) 
+    {
+      lock_acquire (&lock);
+      msg ("Signaling...");
+      cond_signal (&condition, &lock);
+      lock_release (&lock);
+    }
+}
+
+static void
+waiter_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  cond_wait (&condition, &lock);
+  msg ("Thread %s woke up.", thread_name ());
+  lock_release (&lock);
+}
+
+static void
+low_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  sema_down (&go);
+  cond_wait (&condition, &lock);
+  msg ("Thread %s woke up.", thread_name ());
+  lock_release (&lock);
+}
+
+static void
+high_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  msg ("Thread %s got the lock.", thread_name ());
+  lock_release (&lock);
+}
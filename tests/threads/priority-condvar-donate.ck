@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-condvar-donate) begin
+(priority-condvar-donate) Thread high got the lock.
+(priority-condvar-donate) Signaling...
+(priority-condvar-donate) Thread mid woke up.
+(priority-condvar-donate) Signaling...
+(priority-condvar-donate) Thread low woke up.
+(priority-condvar-donate) end
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* The main thread acquires a reader-writer lock for reading.  A
+   medium-priority writer thread acquires a lock and then blocks
+   acquiring the reader-writer lock for writing.  Finally, a
+   high-priority thread blocks acquiring the lock.
+
+   The high-priority thread's donation has to pass through the
+   writer's wait for the reader-writer lock, so the main thread
+   should end up with the high priority.  Once it releases the read
+   lock, the writer, still at the high priority, gets the write lock
+   ahead of everything else. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct locks 
+  {
+    struct rwlock rw;
+    struct lock lock;
+  };
+
+static thread_func writer_thread_func;
+static thread_func high_thread_func;
+
+void
+test_rwlock_donate_nest (void) 
+{
+  struct locks locks;
+  struct rw_hold hold;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rw_init (&locks.rw);
+  lock_init (&locks.lock);
+  rw_read_acquire (&locks.rw, &hold);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &locks);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("high", PRI_DEFAULT + 4, high_thread_func, &locks);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 4, thread_get_priority ());
+  msg ("Main thread releasing read lock.");
+  rw_release (&locks.rw, &hold);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+  msg ("Main thread finished.");
+}
+
+static void
+writer_thread_func (void *locks_) 
+{
+  struct locks *locks = locks_;
+  struct rw_hold hold;
+
+  lock_acquire (&locks->lock);
+  rw_write_acquire (&locks->rw, &hold);
+  msg ("Writer: got the write lock.");
+  msg ("Writer should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 4, thread_get_priority ());
+  rw_release (&locks->rw, &hold);
+  lock_release (&locks->lock);
+  msg ("Writer finished.");
+}
+
+static void
+high_thread_func (void *locks_) 
+{
+  struct locks *locks = locks_;
+
+  lock_acquire (&locks->lock);
+  msg ("High: got the lock.");
+  lock_release (&locks->lock);
+  msg ("High finished.");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate-nest) begin
+(rwlock-donate-nest) Main thread should have priority 32.  Actual priority: 32.
+(rwlock-donate-nest) Main thread should have priority 35.  Actual priority: 35.
+(rwlock-donate-nest) Main thread releasing read lock.
+(rwlock-donate-nest) Writer: got the write lock.
+(rwlock-donate-nest) Writer should have priority 35.  Actual priority: 35.
+(rwlock-donate-nest) High: got the lock.
+(rwlock-donate-nest) High finished.
+(rwlock-donate-nest) Writer finished.
+(rwlock-donate-nest) Main thread should have priority 31.  Actual priority: 31.
+(rwlock-donate-nest) Main thread finished.
+(rwlock-donate-nest) end
+EOF
+pass;
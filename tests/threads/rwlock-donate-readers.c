@@ -0,0 +1,80 @@
+/* The main thread acquires a reader-writer lock for reading.  A
+   second reader then acquires it for reading too, showing that
+   readers share the lock, and blocks on a semaphore.  Next, a
+   high-priority writer blocks acquiring the lock for writing,
+   donating its priority to both readers.
+
+   When both readers have released the lock, the writer should
+   get it immediately, ahead of the lower priority readers
+   finishing up. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct rwlock_and_sema 
+  {
+    struct rwlock rw;
+  struct rw_hold hold;
+    struct semaphore sema;
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_donate_readers (void) 
+{
+  struct rwlock_and_sema rs;
+  struct rw_hold hold;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rw_init (&rs.rw);
+  sema_init (&rs.sema, 0);
+  rw_read_acquire (&rs.rw, &hold);
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rs);
+  thread_create ("writer", PRI_DEFAULT + 5, writer_thread_func, &rs);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  sema_up (&rs.sema);
+  msg ("Main thread releasing read lock.");
+  rw_release (&rs.rw, &hold);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT, thread_get_priority ());
+  msg ("Main thread finished.");
+}
+
+static void
+reader_thread_func (void *rs_) 
+{
+  struct rwlock_and_sema *rs = rs_;
+  struct rw_hold hold;
+
+  rw_read_acquire (&rs->rw, &hold);
+  msg ("Reader: got the read lock.");
+  sema_down (&rs->sema);
+  msg ("Reader should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 5, thread_get_priority ());
+  msg ("Reader releasing read lock.");
+  rw_release (&rs->rw, &hold);
+  msg ("Reader finished.");
+}
+
+static void
+writer_thread_func (void *rs_) 
+{
+  struct rwlock_and_sema *rs = rs_;
+  struct rw_hold hold;
+
+  rw_write_acquire (&rs->rw, &hold);
+  msg ("Writer: got the write lock.");
+  rw_release (&rs->rw, &hold);
+  msg ("Writer finished.");
+}
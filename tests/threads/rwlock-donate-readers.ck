@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate-readers) begin
+(rwlock-donate-readers) Reader: got the read lock.
+(rwlock-donate-readers) Main thread should have priority 36.  Actual priority: 36.
+(rwlock-donate-readers) Main thread releasing read lock.
+(rwlock-donate-readers) Reader should have priority 36.  Actual priority: 36.
+(rwlock-donate-readers) Reader releasing read lock.
+(rwlock-donate-readers) Writer: got the write lock.
+(rwlock-donate-readers) Writer finished.
+(rwlock-donate-readers) Reader finished.
+(rwlock-donate-readers) Main thread should have priority 31.  Actual priority: 31.
+(rwlock-donate-readers) Main thread finished.
+(rwlock-donate-readers) end
+EOF
+pass;
@@ -0,0 +1,66 @@
+/* The main thread acquires a reader-writer lock for reading.  A
+   writer then blocks acquiring it for writing, donating its
+   priority to the main thread.  Next, a reader of the same
+   priority as the writer tries to acquire the lock for reading.
+   Although only readers hold the lock, the new reader must wait,
+   because a writer of equal priority is already waiting.
+
+   When the main thread releases the lock, the writer should get
+   it first, and the reader only after the writer is done. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_writer_pref (void) 
+{
+  struct rwlock rw;
+  struct rw_hold hold;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rw_init (&rw);
+  rw_read_acquire (&rw, &hold);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  msg ("Main thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 1, thread_get_priority ());
+  thread_create ("reader", PRI_DEFAULT + 1, reader_thread_func, &rw);
+  thread_yield ();
+  msg ("Main thread releasing read lock.");
+  rw_release (&rw, &hold);
+  msg ("Writer and reader must already have finished, in that order.");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+  struct rw_hold hold;
+
+  rw_read_acquire (rw, &hold);
+  msg ("Reader: got the read lock.");
+  rw_release (rw, &hold);
+  msg ("Reader finished.");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+  struct rw_hold hold;
+
+  rw_write_acquire (rw, &hold);
+  msg ("Writer: got the write lock.");
+  rw_release (rw, &hold);
+  msg ("Writer finished.");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-pref) begin
+(rwlock-writer-pref) Main thread should have priority 32.  Actual priority: 32.
+(rwlock-writer-pref) Main thread releasing read lock.
+(rwlock-writer-pref) Writer: got the write lock.
+(rwlock-writer-pref) Writer finished.
+(rwlock-writer-pref) Reader: got the read lock.
+(rwlock-writer-pref) Reader finished.
+(rwlock-writer-pref) Writer and reader must already have finished, in that order.
+(rwlock-writer-pref) end
+EOF
+pass;
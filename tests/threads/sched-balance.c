@@ -0,0 +1,94 @@
+/* Benchmarks the run queues and their load balancing.
+
+   Creates THREAD_CNT CPU-bound threads of equal priority.  New
+   threads are spread over the run queues round-robin, and every
+   RQ_CNT'th thread is given HEAVY times as much work as the others,
+   so without stealing and rebalancing one run queue would be left
+   with most of the work.
+
+   Prints the makespan, from creating the first thread to the last
+   one finishing, and the share of that time each run queue spent
+   running its threads.  Timings are informational only; the test
+   checks that every thread finished its work. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 16
+#define WORK 2000000
+#define HEAVY 4
+
+struct worker 
+  {
+    int units;                  /* Work to do, in loop iterations. */
+    volatile int done;          /* Iterations completed. */
+    struct semaphore *finished; /* Upped when done. */
+  };
+
+static thread_func spin;
+
+void
+test_sched_balance (void) 
+{
+  struct worker workers[THREAD_CNT];
+  struct semaphore finished;
+  int64_t busy_start[8], start, makespan;
+  int rq_cnt = thread_rq_count ();
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (rq_cnt <= 8);
+
+  sema_init (&finished, 0);
+  for (i = 0; i < rq_cnt; i++)
+    busy_start[i] = thread_rq_busy_ticks (i);
+
+  /* Let the workers run only once they all exist. */
+  thread_set_priority (PRI_DEFAULT + 1);
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+
+      workers[i].units = i % rq_cnt == 0 ? WORK * HEAVY : WORK;
+      workers[i].done = 0;
+      workers[i].finished = &finished;
+      snprintf (name, sizeof name, "worker %d", i);
+      thread_create (name, PRI_DEFAULT, spin, &workers[i]);
+    }
+  thread_set_priority (PRI_DEFAULT);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&finished);
+  makespan = timer_elapsed (start);
+
+  msg ("%d threads on %d run queues: makespan %"PRId64" ticks.",
+       THREAD_CNT, rq_cnt, makespan);
+  for (i = 0; i < rq_cnt; i++) 
+    {
+      int64_t busy = thread_rq_busy_ticks (i) - busy_start[i];
+      msg ("run queue %d: %"PRId64" busy ticks (%"PRId64"%%).",
+           i, busy, makespan > 0 ? busy * 100 / makespan : 0);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (workers[i].done != workers[i].units)
+      fail ("worker %d did %d of %d units.", i, workers[i].done,
+            workers[i].units);
+  msg ("all workers finished.");
+}
+
+static void
+spin (void *w_) 
+{
+  struct worker *w = w_;
+
+  while (w->done < w->units)
+    w->done++;
+  sema_up (w->finished);
+}
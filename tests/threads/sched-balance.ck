@@ -0,0 +1,36 @@
+# -*- perl -*-
+
+# The expected output looks like this, with one line per run queue:
+#
+# (sched-balance) begin
+# (sched-balance) 16 threads on 1 run queues: makespan 412 ticks.
+# (sched-balance) run queue 0: 409 busy ticks (99%).
+# (sched-balance) all workers finished.
+# (sched-balance) end
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+
+common_checks ("run", @output);
+
+my ($makespan) = grep (/makespan/, @output);
+fail "No makespan found in output.\n" if !defined $makespan;
+my ($rq_cnt) = $makespan =~ /^\(sched-balance\) 16 threads on (\d+) run queues: makespan \d+ ticks\.$/
+  or fail "Malformed makespan line: $makespan\n";
+
+my (@busy) = grep (/busy ticks/, @output);
+fail "$rq_cnt run queues reported but " . scalar (@busy) . " listed\n"
+  if @busy != $rq_cnt;
+for my $i (0...$#busy) {
+    fail "Malformed line for run queue $i: $busy[$i]\n"
+      if $busy[$i] !~ /^\(sched-balance\) run queue $i: \d+ busy ticks \(\d+%\)\.$/;
+}
+
+fail "Not all workers finished.\n"
+  if !grep (/^\(sched-balance\) all workers finished\.$/, @output);
+
+pass;
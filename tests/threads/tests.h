@@ -23,6 +23,13 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_condvar_donate;
+extern test_func test_lock_adaptive;
+extern test_func test_rwlock_donate_readers;
+extern test_func test_rwlock_donate_nest;
+extern test_func test_rwlock_writer_pref;
+extern test_func test_sched_balance;
+extern test_func test_palloc_latency;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -0,0 +1,50 @@
+/* Measures the cost of switching between two processes.
+
+   Forks a child, and then parent and child take turns, each
+   yielding the CPU to the other ROUNDS times.  Every turn touches
+   PAGE_CNT pages of the process's own memory, so that a switch
+   that flushes the TLB is also paid for in page walks afterward.
+   Reports the average time stamp counter cycles per round trip,
+   measured by the parent.  Timings are informational only. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ROUNDS 1000
+#define PAGE_CNT 16
+
+static char buf[PAGE_CNT][4096];
+
+static void
+take_turns (void) 
+{
+  int i, j;
+
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      for (j = 0; j < PAGE_CNT; j++)
+        buf[j][i % sizeof buf[j]]++;
+      yield ();
+    }
+}
+
+void
+test_main (void) 
+{
+  uint64_t start, cycles;
+  int pid;
+
+  if ((pid = fork ("child")) == 0) 
+    {
+      take_turns ();
+      exit (0);
+    }
+
+  start = rdtsc ();
+  take_turns ();
+  CHECK (wait (pid) == 0, "wait for child");
+  cycles = rdtsc () - start;
+  msg ("%d round trips, %llu cycles each", ROUNDS,
+       (unsigned long long) (cycles / ROUNDS));
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+s/^\(fork-ctxsw\) 1000 round trips, \d+ cycles each$/(fork-ctxsw) 1000 round trips, N cycles each/
+  foreach @output;
+compare_output ("run", \@output, [<<'EOF']);
+(fork-ctxsw) begin
+child: exit(0)
+(fork-ctxsw) wait for child
+(fork-ctxsw) 1000 round trips, N cycles each
+(fork-ctxsw) end
+fork-ctxsw: exit(0)
+EOF
+pass;
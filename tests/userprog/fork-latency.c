@@ -0,0 +1,31 @@
+/* Measures how long it takes to fork a child that exits right
+   away and to wait for it, averaged over FORK_CNT children, in
+   time stamp counter cycles.  Most of that time goes into
+   creating and destroying the child's page tables.  Timings are
+   informational only. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FORK_CNT 50
+
+void
+test_main (void) 
+{
+  uint64_t start = rdtsc ();
+  int i;
+
+  for (i = 0; i < FORK_CNT; i++) 
+    {
+      int pid = fork ("child");
+      if (pid == 0)
+        exit (i);
+      if (pid < 0)
+        fail ("fork %d failed", i);
+      if (wait (pid) != i)
+        fail ("child %d exited with the wrong status", i);
+    }
+  msg ("%d forks, %llu cycles each", FORK_CNT,
+       (unsigned long long) ((rdtsc () - start) / FORK_CNT));
+}
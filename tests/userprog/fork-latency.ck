@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+my ($timing) = grep (/^\(fork-latency\) \d+ forks, /, @output);
+fail "fork-latency did not report its timing\n"
+  if !defined $timing || $timing !~ /^\(fork-latency\) 50 forks, \d+ cycles each$/;
+
+my ($expected) = "(fork-latency) begin\n";
+$expected .= "child: exit($_)\n" foreach 0...49;
+$expected .= "$timing\n(fork-latency) end\nfork-latency: exit(0)\n";
+compare_output ("run", \@output, [$expected]);
+pass;
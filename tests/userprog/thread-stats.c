@@ -0,0 +1,45 @@
+/* Takes a snapshot of the scheduling statistics with the
+   thread_stats system call, checks that it is well formed and
+   that it includes the calling process, and checks that a buffer
+   too small for the header is refused. */
+
+#include <string.h>
+#include <syscall.h>
+#include <thread-stats.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  struct thread_stats_header *h = (struct thread_stats_header *) buf;
+  struct thread_stats_record *r = (struct thread_stats_record *) (h + 1);
+  bool found = false;
+  int cnt, i;
+
+  memset (buf, 0, sizeof buf);
+  cnt = thread_stats (buf, sizeof buf);
+  CHECK (cnt > 0, "thread_stats");
+  if (h->magic != THREAD_STATS_MAGIC)
+    fail ("bad magic %x", h->magic);
+  if (h->record_size != sizeof *r)
+    fail ("record size %u, expected %zu", h->record_size, sizeof *r);
+  if (h->record_cnt != (unsigned) cnt || h->thread_cnt < h->record_cnt)
+    fail ("bad counts %u, %u", h->record_cnt, h->thread_cnt);
+
+  for (i = 0; i < cnt; i++)
+    if (!strcmp (r[i].name, "thread-stats"))
+      {
+        found = true;
+        if (r[i].stats.run_ticks < 0 || r[i].stats.ready_ticks < 0
+            || r[i].stats.lock_wait_ticks < 0)
+          fail ("negative tick count");
+      }
+  if (!found)
+    fail ("no record for this process");
+  msg ("found own record");
+
+  CHECK (thread_stats (buf, sizeof *h - 1) == -1, "buffer too small");
+}
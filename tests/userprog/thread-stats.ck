@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(thread-stats) begin
+(thread-stats) thread_stats
+(thread-stats) found own record
+(thread-stats) buffer too small
+(thread-stats) end
+thread-stats: exit(0)
+EOF
+pass;
@@ -0,0 +1,40 @@
+/* Checks that read() into a buffer that a forked child shares
+   copy-on-write with its parent gives the child a copy of its own,
+   instead of the kernel writing into the shared frame. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/sample.inc"
+
+static char buf[4096] = "Lorem ipsum";
+
+void
+test_main (void)
+{
+	void *pa_parent;
+	pid_t child;
+	int handle;
+
+	CHECK (strcmp (buf, "Lorem ipsum") == 0, "check data consistency");
+	pa_parent = get_phys_addr ((void *) buf);
+
+	child = fork ("child");
+	if (child == 0) {
+		CHECK (pa_parent == get_phys_addr ((void *) buf),
+				"two phys addrs should be the same.");
+		CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+		CHECK (read (handle, buf, sizeof buf) == (int) strlen (sample),
+				"read \"sample.txt\"");
+		CHECK (memcmp (buf, sample, strlen (sample)) == 0, "check data change");
+		CHECK (pa_parent != get_phys_addr ((void *) buf),
+				"two phys addrs should not be the same.");
+		close (handle);
+		return;
+	}
+	wait (child);
+	CHECK (pa_parent == get_phys_addr ((void *) buf),
+			"two phys addrs should be the same.");
+	CHECK (strcmp (buf, "Lorem ipsum") == 0, "check data consistency");
+}
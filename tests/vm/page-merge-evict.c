@@ -0,0 +1,12 @@
+/* Runs the page-merge-par workload in much less memory than it
+   touches, so that frames keep being evicted while the children
+   sort in parallel. */
+
+#include "tests/main.h"
+#include "tests/vm/parallel-merge.h"
+
+void
+test_main (void) 
+{
+  parallel_merge ("child-sort", 123);
+}
@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-merge-evict) begin
+(page-merge-evict) init
+(page-merge-evict) sort chunk 0
+(page-merge-evict) sort chunk 1
+(page-merge-evict) sort chunk 2
+(page-merge-evict) sort chunk 3
+(page-merge-evict) sort chunk 4
+(page-merge-evict) sort chunk 5
+(page-merge-evict) sort chunk 6
+(page-merge-evict) sort chunk 7
+(page-merge-evict) wait for child 0
+(page-merge-evict) wait for child 1
+(page-merge-evict) wait for child 2
+(page-merge-evict) wait for child 3
+(page-merge-evict) wait for child 4
+(page-merge-evict) wait for child 5
+(page-merge-evict) wait for child 6
+(page-merge-evict) wait for child 7
+(page-merge-evict) merge
+(page-merge-evict) verify
+(page-merge-evict) success, buf_idx=1,048,576
+(page-merge-evict) end
+EOF
+
+# The point of the test is to run under memory pressure, so make
+# sure that the kernel did have to evict.
+our ($test);
+my ($evicted) = map (/^Frames: (\d+) evicted/, read_text_file ("$test.output"));
+fail "no frames were evicted\n" if !defined ($evicted) || $evicted == 0;
+pass;
@@ -0,0 +1,41 @@
+/* Fills an array much larger than memory one page at a time, then
+   reads it back in the same order twice.  The pages are swapped
+   out in order, so they should be swapped back in with read-ahead
+   rather than one fault per page. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ONE_MB (1 << 20)
+#define CHUNK_SIZE (16 * ONE_MB)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static uint32_t big_chunk[CHUNK_SIZE / sizeof (uint32_t)];
+
+void
+test_main (void)
+{
+  size_t i, pass;
+
+  msg ("fill");
+  for (i = 0; i < PAGE_COUNT; i++)
+    {
+      uint32_t *page = big_chunk + i * (PAGE_SIZE / sizeof (uint32_t));
+      page[0] = i;
+      page[PAGE_SIZE / sizeof (uint32_t) - 1] = ~i;
+    }
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      msg ("check pass %zu", pass);
+      for (i = 0; i < PAGE_COUNT; i++)
+        {
+          uint32_t *page = big_chunk + i * (PAGE_SIZE / sizeof (uint32_t));
+          if (page[0] != i || page[PAGE_SIZE / sizeof (uint32_t) - 1] != ~i)
+            fail ("data is inconsistent in page %zu", i);
+        }
+    }
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-seq) begin
+(swap-seq) fill
+(swap-seq) check pass 0
+(swap-seq) check pass 1
+(swap-seq) end
+EOF
+
+# Sequential faults on swapped-out pages should have been served by
+# read-ahead.
+our ($test);
+my ($readahead) = map (/^Swap read-ahead: (\d+) pages/,
+		       read_text_file ("$test.output"));
+fail "no pages were read ahead\n" if !defined ($readahead) || $readahead == 0;
+pass;
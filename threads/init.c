@@ -18,9 +18,13 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
+#include "threads/mp.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
+#include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -92,7 +96,9 @@ main (void) {
 	/* Initialize memory system. */
 	mem_end = palloc_init ();
 	malloc_init ();
+	kmem_init ();
 	paging_init (mem_end);
+	mp_init ();
 
 #ifdef USERPROG
 	tss_init ();
@@ -102,6 +108,7 @@ main (void) {
 	/* Initialize interrupt handlers. */
 	intr_init ();
 	timer_init ();
+	trace_init ();
 	kbd_init ();
 	input_init ();
 #ifdef USERPROG
@@ -112,6 +119,10 @@ main (void) {
 	thread_start ();
 	serial_init_queue ();
 	timer_calibrate ();
+	mp_start_aps ();
+#ifdef USERPROG
+	palloc_zero_init ();
+#endif
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -150,29 +161,62 @@ bss_init (void) {
 
 /* Populates the page table with the kernel virtual mapping,
  * and then sets up the CPU to use the new page directory.
- * Points base_pml4 to the pml4 it creates. */
+ * Points base_pml4 to the pml4 it creates.
+ *
+ * Each 2 MiB region that lies entirely below MEM_END is mapped with
+ * a single large page, which needs no page table and only one TLB
+ * entry.  Only the tail of memory and the regions that hold kernel
+ * text, which must be mapped read-only page by page, get 4 KiB
+ * pages.  All of these mappings are global, so that switching
+ * address spaces does not flush them from the TLB (see tlb_init()). */
 static void
 paging_init (uint64_t mem_end) {
 	uint64_t *pml4, *pte;
+	uint64_t start_tsc = rdtsc ();
+	size_t large_cnt = 0, small_cnt = 0, pt_cnt = 0;
+	uint64_t pt_region = (uint64_t) -1;
 	int perm;
 	pml4 = base_pml4 = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 
 	extern char start, _end_kernel_text;
+	uint64_t text_start = (uint64_t) &start;
+	uint64_t text_end = (uint64_t) &_end_kernel_text;
 	// Maps physical address [0 ~ mem_end] to
 	//   [LOADER_KERN_BASE ~ LOADER_KERN_BASE + mem_end].
-	for (uint64_t pa = 0; pa < mem_end; pa += PGSIZE) {
+	for (uint64_t pa = 0; pa < mem_end; ) {
 		uint64_t va = (uint64_t) ptov(pa);
 
-		perm = PTE_P | PTE_W;
-		if ((uint64_t) &start <= va && va < (uint64_t) &_end_kernel_text)
+		if (pa % LARGE_PGSIZE == 0 && pa + LARGE_PGSIZE <= mem_end
+				&& (va + LARGE_PGSIZE <= text_start || text_end <= va)) {
+			if ((pte = pml4e_walk_pde (pml4, va, 1)) == NULL)
+				PANIC ("paging_init: out of memory");
+			*pte = pa | PTE_P | PTE_W | PTE_G | PTE_PS;
+			large_cnt++;
+			pa += LARGE_PGSIZE;
+			continue;
+		}
+
+		perm = PTE_P | PTE_W | PTE_G;
+		if (text_start <= va && va < text_end)
 			perm &= ~PTE_W;
 
 		if ((pte = pml4e_walk (pml4, va, 1)) != NULL)
 			*pte = pa | perm;
+		if (va >> LARGE_PGSHIFT != pt_region) {
+			pt_region = va >> LARGE_PGSHIFT;
+			pt_cnt++;
+		}
+		small_cnt++;
+		pa += PGSIZE;
 	}
 
 	// reload cr3
 	pml4_activate(0);
+	tlb_init ();
+
+	printf ("Direct map: %zu 2 MiB pages, %zu 4 KiB pages in %zu page tables, "
+			"%llu cycles\n",
+			large_cnt, small_cnt, pt_cnt, rdtsc () - start_tsc);
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -229,6 +273,10 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-tickless"))
+			timer_tickless = true;
+		else if (!strcmp (name, "-trace"))
+			trace_enabled = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -278,7 +326,9 @@ run_actions (char **argv) {
 	// "run" 과 동일한 argv가 들어와야 run_task() 함수 실행
 	static const struct action actions[] = {
 		{"run", 2, run_task},
+		{"trace-dump", 1, trace_dump},
 #ifdef FILESYS
+		{"trace-save", 2, trace_save},
 		{"ls", 1, fsutil_ls},
 		{"cat", 2, fsutil_cat},
 		{"rm", 2, fsutil_rm},
@@ -327,6 +377,7 @@ usage (void) {
 #else
 			"  run TEST           Run TEST.\n"
 #endif
+			"  trace-dump         Print the trace buffer (see -trace).\n"
 #ifdef FILESYS
 			"  ls                 List files in the root directory.\n"
 			"  cat FILE           Print FILE to the console.\n"
@@ -334,6 +385,7 @@ usage (void) {
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
 			"  put FILE           Put FILE into file system from scratch disk.\n"
 			"  get FILE           Get FILE from file system into scratch disk.\n"
+			"  trace-save FILE    Save the trace buffer into FILE (see -trace).\n"
 #endif
 			"\nOptions:\n"
 			"  -h                 Print this help message and power off.\n"
@@ -341,6 +393,8 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -tickless          Stop the timer tick while the CPU is idle.\n"
+			"  -trace             Record scheduler, interrupt and I/O events.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -369,6 +423,12 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	palloc_print_stats ();
+	malloc_print_stats ();
+	kmem_cache_print_stats ();
+#ifdef VM
+	vm_print_stats ();
+#endif
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
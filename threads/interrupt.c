@@ -7,6 +7,7 @@
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
@@ -203,6 +204,13 @@ intr_init (void) {
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Loads the IDT that intr_init() built on an application
+   processor. */
+void
+intr_init_ap (void) {
+	lidt(&idt_desc);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -346,6 +354,8 @@ intr_handler (struct intr_frame *frame) {
 		yield_on_return = false;
 	}
 
+	trace (TRACE_INTR, TRACE_BEGIN, frame->vec_no);
+
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
@@ -361,6 +371,8 @@ intr_handler (struct intr_frame *frame) {
 		PANIC ("Unexpected interrupt");
 	}
 
+	trace (TRACE_INTR, TRACE_END, frame->vec_no);
+
 	/* Complete the processing of an external interrupt. */
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
@@ -370,7 +382,7 @@ intr_handler (struct intr_frame *frame) {
 		pic_end_of_interrupt (frame->vec_no);
 
 		if (yield_on_return)
-			thread_yield ();
+			thread_preempt ();
 	}
 }
 
@@ -5,17 +5,21 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
-   the free list is nonempty, one of its blocks is used to
-   satisfy the request.
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  The size classes are the powers
+   of 2 and the points halfway between them (48, 96, 192, ...), so
+   that no more than a third of a block is wasted.  The descriptor
+   keeps a list of free blocks.  If the free list is nonempty, one
+   of its blocks is used to satisfy the request.
 
    Otherwise, a new page of memory, called an "arena", is
    obtained from the page allocator (if none is available,
@@ -28,6 +32,16 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
+   Before all that, each thread keeps a few blocks of each size
+   that it freed recently in its struct malloc_cache, and reuses
+   them without taking the descriptor's lock.  The cache is itself
+   a malloc() block, allocated on the thread's first free().  A
+   thread's cached blocks still count as in use for their arenas,
+   and go back to their descriptors when the thread exits.  So
+   that a long-lived thread cannot keep many arenas from being
+   freed, the blocks cached for a size class all come from a
+   single arena: a block from any other arena is freed as usual.
+
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
@@ -38,10 +52,23 @@
 struct desc {
 	size_t block_size;          /* Size of each element in bytes. */
 	size_t blocks_per_arena;    /* Number of blocks in an arena. */
+	size_t cache_max;           /* Blocks a thread may cache. */
 	struct list free_list;      /* List of free blocks. */
 	struct lock lock;           /* Lock. */
+
+	/* Statistics, updated with interrupts off. */
+	unsigned long long alloc_cnt;   /* Blocks handed out. */
+	unsigned long long requested;   /* Bytes asked for in total. */
+};
+
+/* Block sizes of the descriptors. */
+static const size_t class_sizes[MALLOC_CLASSES] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024,
 };
 
+/* Total bytes of thread caches per size class. */
+#define MALLOC_CACHE_BYTES 2048
+
 /* Magic number for detecting arena corruption. */
 #define ARENA_MAGIC 0x9a548eed
 
@@ -58,27 +85,45 @@ struct block {
 };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_CLASSES];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics for big blocks, updated with interrupts off. */
+static unsigned long long big_cnt;          /* Big blocks handed out. */
+static unsigned long long big_requested;    /* Bytes asked for in total. */
+static unsigned long long big_pages;        /* Pages handed out in total. */
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void desc_free (struct desc *, struct block *);
 
 /* Initializes the malloc() descriptors. */
 void
 malloc_init (void) {
-	size_t block_size;
+	size_t i;
 
-	for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2) {
+	for (i = 0; i < MALLOC_CLASSES; i++) {
 		struct desc *d = &descs[desc_cnt++];
-		ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-		d->block_size = block_size;
-		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+		d->block_size = class_sizes[i];
+		d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / d->block_size;
+		d->cache_max = MALLOC_CACHE_BYTES / d->block_size;
+		if (d->cache_max > d->blocks_per_arena)
+			d->cache_max = d->blocks_per_arena;
+		ASSERT (d->cache_max > 0 && d->cache_max <= UINT8_MAX);
 		list_init (&d->free_list);
 		lock_init (&d->lock);
 	}
 }
 
+/* Counts a block of descriptor D handed out for SIZE bytes. */
+static void
+desc_account (struct desc *d, size_t size) {
+	enum intr_level old_level = intr_disable ();
+	d->alloc_cnt++;
+	d->requested += size;
+	intr_set_level (old_level);
+}
+
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
@@ -109,9 +154,28 @@ malloc (size_t size) {
 		a->magic = ARENA_MAGIC;
 		a->desc = NULL;
 		a->free_cnt = page_cnt;
+
+		enum intr_level old_level = intr_disable ();
+		big_cnt++;
+		big_requested += size;
+		big_pages += page_cnt;
+		intr_set_level (old_level);
 		return a + 1;
 	}
 
+	/* Reuse a block this thread freed recently, if any. */
+	struct malloc_cache *mc = thread_current ()->malloc_cache;
+	size_t idx = d - descs;
+
+	ASSERT (!intr_context ());
+	if (mc != NULL && mc->cnt[idx] > 0) {
+		b = mc->blocks[idx];
+		mc->blocks[idx] = *(void **) b;
+		mc->cnt[idx]--;
+		desc_account (d, size);
+		return b;
+	}
+
 	lock_acquire (&d->lock);
 
 	/* If the free list is empty, create a new arena. */
@@ -140,6 +204,7 @@ malloc (size_t size) {
 	a = block_to_arena (b);
 	a->free_cnt--;
 	lock_release (&d->lock);
+	desc_account (d, size);
 	return b;
 }
 
@@ -196,6 +261,17 @@ realloc (void *old_block, size_t new_size) {
 	}
 }
 
+/* Returns the running thread's block cache, allocating it on
+   first use, or a null pointer if memory is not available. */
+static struct malloc_cache *
+malloc_cache_get (void) {
+	struct thread *curr = thread_current ();
+
+	if (curr->malloc_cache == NULL)
+		curr->malloc_cache = calloc (1, sizeof *curr->malloc_cache);
+	return curr->malloc_cache;
+}
+
 /* Frees block P, which must have been previously allocated with
    malloc(), calloc(), or realloc(). */
 void
@@ -207,30 +283,27 @@ free (void *p) {
 
 		if (d != NULL) {
 			/* It's a normal block.  We handle it here. */
+			struct malloc_cache *mc = malloc_cache_get ();
+			size_t idx = d - descs;
 
 #ifndef NDEBUG
 			/* Clear the block to help detect use-after-free bugs. */
 			memset (b, 0xcc, d->block_size);
 #endif
 
-			lock_acquire (&d->lock);
-
-			/* Add block to free list. */
-			list_push_front (&d->free_list, &b->free_elem);
-
-			/* If the arena is now entirely unused, free it. */
-			if (++a->free_cnt >= d->blocks_per_arena) {
-				size_t i;
-
-				ASSERT (a->free_cnt == d->blocks_per_arena);
-				for (i = 0; i < d->blocks_per_arena; i++) {
-					struct block *b = arena_to_block (a, i);
-					list_remove (&b->free_elem);
-				}
-				palloc_free_page (a);
+			/* Keep it for this thread if there is room and it comes
+			   from the same arena as the blocks already cached. */
+			ASSERT (!intr_context ());
+			if (mc != NULL && mc->cnt[idx] < d->cache_max
+					&& (mc->cnt[idx] == 0
+						|| block_to_arena (mc->blocks[idx]) == a)) {
+				*(void **) b = mc->blocks[idx];
+				mc->blocks[idx] = b;
+				mc->cnt[idx]++;
+				return;
 			}
 
-			lock_release (&d->lock);
+			desc_free (d, b);
 		} else {
 			/* It's a big block.  Free its pages. */
 			palloc_free_multiple (a, a->free_cnt);
@@ -238,7 +311,85 @@ free (void *p) {
 		}
 	}
 }
-
+
+/* Returns block B to descriptor D's free list, and its arena to
+   the page allocator if the arena is now entirely unused. */
+static void
+desc_free (struct desc *d, struct block *b) {
+	struct arena *a = block_to_arena (b);
+
+	lock_acquire (&d->lock);
+
+	/* Add block to free list. */
+	list_push_front (&d->free_list, &b->free_elem);
+
+	/* If the arena is now entirely unused, free it. */
+	if (++a->free_cnt >= d->blocks_per_arena) {
+		size_t i;
+
+		ASSERT (a->free_cnt == d->blocks_per_arena);
+		for (i = 0; i < d->blocks_per_arena; i++) {
+			struct block *b = arena_to_block (a, i);
+			list_remove (&b->free_elem);
+		}
+		palloc_free_page (a);
+	}
+
+	lock_release (&d->lock);
+}
+
+/* Gives the blocks in the running thread's cache, and the cache
+   itself, back to their descriptors.  Called by thread_exit(). */
+void
+malloc_thread_exit (void) {
+	struct thread *curr = thread_current ();
+	struct malloc_cache *mc = curr->malloc_cache;
+	size_t i;
+
+	if (mc == NULL)
+		return;
+	for (i = 0; i < desc_cnt; i++)
+		while (mc->cnt[i] > 0) {
+			struct block *b = mc->blocks[i];
+			mc->blocks[i] = *(void **) b;
+			mc->cnt[i]--;
+			desc_free (&descs[i], b);
+		}
+
+	/* Not free(), which would only put MC back in a cache. */
+	curr->malloc_cache = NULL;
+	desc_free (block_to_arena ((struct block *) mc)->desc, (struct block *) mc);
+}
+
+/* Prints, for each size class in use and for big blocks, how many
+   bytes were asked for and how many were handed out. */
+void
+malloc_print_stats (void) {
+	unsigned long long requested = big_requested;
+	unsigned long long handed_out = big_pages * PGSIZE;
+	size_t i;
+
+	for (i = 0; i < desc_cnt; i++) {
+		struct desc *d = &descs[i];
+		unsigned long long bytes = d->alloc_cnt * d->block_size;
+
+		if (d->alloc_cnt == 0)
+			continue;
+		printf ("malloc: %4zu-byte blocks: %llu allocs, "
+				"%llu bytes requested, %llu handed out\n",
+				d->block_size, d->alloc_cnt, d->requested, bytes);
+		requested += d->requested;
+		handed_out += bytes;
+	}
+	if (big_cnt > 0)
+		printf ("malloc: big blocks: %llu allocs, "
+				"%llu bytes requested, %llu handed out\n",
+				big_cnt, big_requested, big_pages * PGSIZE);
+	printf ("malloc: %llu bytes requested, %llu handed out (%llu%% wasted)\n",
+			requested, handed_out,
+			handed_out > 0 ? (handed_out - requested) * 100 / handed_out : 0);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b) {
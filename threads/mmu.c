@@ -1,21 +1,155 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* TLB tagging.
+ *
+ * Kernel mappings are global (PTE_G), so once tlb_init() sets
+ * CR4.PGE they survive CR3 loads.  If the CPU also supports PCIDs,
+ * each of the last PCID_SLOTS user address spaces to run owns a
+ * PCID, and switching back to one of them keeps the TLB entries it
+ * left behind.  Any other address space takes over the oldest slot
+ * and flushes that PCID as it loads CR3.  Kernel threads run on
+ * base_pml4 with PCID 0.
+ *
+ * Entries cached under a PCID go stale when a PTE of an address
+ * space that is not running changes, or when its pml4 is freed and
+ * the page reused for another one.  Both cases drop the address
+ * space's slot (see pcid_forget()), so it is flushed the next time it
+ * runs.  There would be one set of slots per CPU. */
+#define PCID_SLOTS 8
+static bool pcid_enabled;
+static uint64_t *pcid_owner[PCID_SLOTS];  /* Slot I is PCID I + 1. */
+static int pcid_next;                     /* Next slot to take over. */
+
+/* CPUID leaf 1 feature bits. */
+#define CPUID_1_EDX_PGE (1U << 13)
+#define CPUID_1_ECX_PCID (1U << 17)
+
+/* Turns on global pages and PCIDs, as far as the CPU supports
+ * them.  Must be called with base_pml4 loaded. */
+void
+tlb_init (void) {
+	uint32_t regs[4];
+	bool pge = false;
+
+	cpuid (1, regs);
+	if (regs[3] & CPUID_1_EDX_PGE) {
+		lcr4 (rcr4 () | CR4_PGE);
+		pge = true;
+	}
+	if (regs[2] & CPUID_1_ECX_PCID) {
+		ASSERT ((rcr3 () & CR3_PCID_MASK) == 0);
+		lcr4 (rcr4 () | CR4_PCIDE);
+		pcid_enabled = true;
+	}
+	printf ("TLB: global pages %s, PCIDs %s\n",
+			pge ? "on" : "unsupported", pcid_enabled ? "on" : "unsupported");
+}
+
+/* Returns the PCID bits to load into CR3 along with PML4, taking
+ * over a slot if PML4 has none.  Interrupts must be off. */
+static uint64_t
+pcid_cr3_bits (uint64_t *pml4) {
+	int slot;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+	if (pml4 == base_pml4)
+		return CR3_NOFLUSH;
+	for (slot = 0; slot < PCID_SLOTS; slot++)
+		if (pcid_owner[slot] == pml4)
+			return (slot + 1) | CR3_NOFLUSH;
+
+	slot = pcid_next;
+	pcid_next = (pcid_next + 1) % PCID_SLOTS;
+	pcid_owner[slot] = pml4;
+	return slot + 1;
+}
+
+/* Drops PML4's PCID slot, if it has one, so that its TLB entries are
+ * flushed before it runs again. */
+static void
+pcid_forget (uint64_t *pml4) {
+	enum intr_level old_level = intr_disable ();
+	int slot;
+
+	for (slot = 0; slot < PCID_SLOTS; slot++)
+		if (pcid_owner[slot] == pml4)
+			pcid_owner[slot] = NULL;
+	intr_set_level (old_level);
+}
+
+/* Returns true if PML4 is loaded in CR3. */
+static bool
+pml4_is_active (uint64_t *pml4) {
+	return PTE_ADDR (rcr3 ()) == vtop (pml4);
+}
+
+/* Makes sure no TLB holds a stale translation for VA in PML4, after
+ * its PTE was changed. */
+static void
+tlb_flush_page (uint64_t *pml4, const void *va) {
+	if (pml4_is_active (pml4))
+		invlpg ((uint64_t) va);
+	else if (pcid_enabled)
+		pcid_forget (pml4);
+}
+
+/* Page-table pages.
+ *
+ * Tables for user address spaces come and go with every fork, exec
+ * and exit, so up to PT_POOL_MAX freed ones are kept for reuse.  A
+ * table is torn down by clearing its entries one by one, which
+ * leaves the page zeroed, so the pool hands out pages that are ready
+ * to use as new tables without another memset(). */
+#define PT_POOL_MAX 64
+static void *pt_pool[PT_POOL_MAX];
+static size_t pt_pool_cnt;
+
+/* Returns a zeroed page for a page table, or a null pointer if
+ * memory is not available. */
+static void *
+pt_alloc (void) {
+	enum intr_level old_level = intr_disable ();
+	void *page = pt_pool_cnt > 0 ? pt_pool[--pt_pool_cnt] : NULL;
+	intr_set_level (old_level);
+
+	return page != NULL ? page : palloc_get_page (PAL_ZERO);
+}
+
+/* Frees PAGE, a page table whose entries must all be zero. */
+static void
+pt_free (void *page) {
+	enum intr_level old_level = intr_disable ();
+	if (pt_pool_cnt < PT_POOL_MAX) {
+		pt_pool[pt_pool_cnt++] = page;
+		page = NULL;
+	}
+	intr_set_level (old_level);
+
+	if (page != NULL)
+		palloc_free_page (page);
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		/* A 2 MiB page has no page table: the PDE is the leaf. */
+		if (((uint64_t) pte & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
+			return &pdp[idx];
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page)
 					pdp[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 				else
@@ -37,7 +171,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		uint64_t *pde = (uint64_t *) pdpe[idx];
 		if (!((uint64_t) pde & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pdpe[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -49,7 +183,7 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
 		pte = pgdir_walk (ptov (PTE_ADDR (pdpe[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pdpe[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pdpe[idx])));
 		pdpe[idx] = 0;
 	}
 	return pte;
@@ -60,7 +194,9 @@ pdpe_walk (uint64_t *pdpe, const uint64_t va, int create) {
  * If PML4E does not have a page table for VADDR, behavior depends
  * on CREATE.  If CREATE is true, then a new page table is
  * created and a pointer into it is returned.  Otherwise, a null
- * pointer is returned. 
+ * pointer is returned.
+ * If VADDR lies in a 2 MiB page, returns the address of its page
+ * directory entry, which has PTE_PS set, instead. 
  * 
  * 페이지 맵 수준 4, pml4에서 가상 주소 VADDR에 대한 페이지 테이블 항목의 주소를 반환합니다.PML4E에 VADDR에 대한 페이지 테이블이 없는 경우 동작은 CREATE에 따라 달라집니다. CREATE가 참일 경우, 새 페이지 테이블이 작성되고 해당 테이블로의 포인터가 반환됩니다.
  * 그렇지 않으면 null 포인터가 반환됩니다.
@@ -75,7 +211,7 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		uint64_t *pdpe = (uint64_t *) pml4e[idx];
 		if (!((uint64_t) pdpe & PTE_P)) {
 			if (create) {
-				uint64_t *new_page = palloc_get_page (PAL_ZERO);
+				uint64_t *new_page = pt_alloc ();
 				if (new_page) {
 					pml4e[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
 					allocated = 1;
@@ -87,21 +223,71 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 		pte = pdpe_walk (ptov (PTE_ADDR (pml4e[idx])), va, create);
 	}
 	if (pte == NULL && allocated) {
-		palloc_free_page ((void *) ptov (PTE_ADDR (pml4e[idx])));
+		pt_free ((void *) ptov (PTE_ADDR (pml4e[idx])));
 		pml4e[idx] = 0;
 	}
 	return pte;
 }
 
+/* Returns the kernel virtual address of the table that entry IDX
+ * of TABLE points to, creating it if it is absent and CREATE is
+ * true.  Returns a null pointer if there is no such table. */
+static uint64_t *
+table_walk (uint64_t *table, int idx, int create) {
+	if (!(table[idx] & PTE_P)) {
+		uint64_t *new_page;
+
+		if (!create || (new_page = pt_alloc ()) == NULL)
+			return NULL;
+		table[idx] = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+	}
+	return ptov (PTE_ADDR (table[idx]));
+}
+
+/* Returns the address of the page directory entry for virtual
+ * address VA in PML4E, creating the page directory pointer table
+ * and page directory on the way if CREATE is true.  Setting PTE_PS
+ * in the entry maps VA's 2 MiB region with a single large page.
+ * Returns a null pointer if a table is missing or cannot be
+ * allocated; tables created before the failure are left in place. */
+uint64_t *
+pml4e_walk_pde (uint64_t *pml4e, const uint64_t va, int create) {
+	uint64_t *pdpe, *pgdir;
+
+	if (pml4e == NULL
+			|| (pdpe = table_walk (pml4e, PML4 (va), create)) == NULL
+			|| (pgdir = table_walk (pdpe, PDPE (va), create)) == NULL)
+		return NULL;
+	return &pgdir[PDX (va)];
+}
+
+/* PML4 entries from KERN_PML4 up to kern_pml4_end map the kernel.
+ * Every pml4 shares the page directory pointer tables they point
+ * to with base_pml4, which never changes after paging_init(). */
+#define KERN_PML4 PML4 (KERN_BASE)
+static unsigned kern_pml4_end;
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
+ * Only the kernel's PML4 entries are copied; the tables below them
+ * are shared.
  * Returns the new page directory, or a null pointer if memory
  * allocation fails. */
 uint64_t *
 pml4_create (void) {
-	uint64_t *pml4 = palloc_get_page (0);
+	uint64_t *pml4 = pt_alloc ();
+	unsigned i;
+
+	if (kern_pml4_end == 0) {
+		for (i = PGSIZE / sizeof *base_pml4; i > KERN_PML4; i--)
+			if (base_pml4[i - 1] != 0)
+				break;
+		kern_pml4_end = i;
+	}
+
 	if (pml4)
-		memcpy (pml4, base_pml4, PGSIZE);
+		for (i = KERN_PML4; i < kern_pml4_end; i++)
+			pml4[i] = base_pml4[i];
 	return pml4;
 }
 
@@ -127,7 +313,14 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if (((uint64_t) pte) & PTE_P && ((uint64_t) pte) & PTE_PS) {
+			/* 2 MiB page: FUNC gets the PDE itself. */
+			void *va = (void *) (((uint64_t) pml4_index << PML4SHIFT) |
+								 ((uint64_t) pdp_index << PDPESHIFT) |
+								 ((uint64_t) i << PDXSHIFT));
+			if (!func (&pdp[i], va, aux))
+				return false;
+		} else if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -148,7 +341,9 @@ pdp_for_each (uint64_t *pdp,
 	return true;
 }
 
-/* Apply FUNC to each available pte entries including kernel's. */
+/* Apply FUNC to each available pte entries including kernel's.
+ * For a 2 MiB page, FUNC is called once, on its page directory
+ * entry, which has PTE_PS set. */
 bool
 // 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
@@ -161,24 +356,30 @@ pml4_for_each (uint64_t *pml4, pte_for_each_func *func, void *aux) {
 	return true;
 }
 
+/* The destroy functions clear each entry as they go, so that the
+ * table is all zeros by the time it is handed to pt_free(). */
 static void
 pt_destroy (uint64_t *pt) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pt[i]);
 		if (((uint64_t) pte) & PTE_P)
 			palloc_free_page ((void *) PTE_ADDR (pte));
+		pt[i] = 0;
 	}
-	palloc_free_page ((void *) pt);
+	pt_free ((void *) pt);
 }
 
 static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		/* A 2 MiB page maps memory that palloc does not own, and has
+		   no page table to free. */
+		if (((uint64_t) pte) & PTE_P && !(((uint64_t) pte) & PTE_PS))
 			pt_destroy (PTE_ADDR (pte));
+		pdp[i] = 0;
 	}
-	palloc_free_page ((void *) pdp);
+	pt_free ((void *) pdp);
 }
 
 static void
@@ -187,29 +388,48 @@ pdpe_destroy (uint64_t *pdpe) {
 		uint64_t *pde = ptov((uint64_t *) pdpe[i]);
 		if (((uint64_t) pde) & PTE_P)
 			pgdir_destroy ((void *) PTE_ADDR (pde));
+		pdpe[i] = 0;
 	}
-	palloc_free_page ((void *) pdpe);
+	pt_free ((void *) pdpe);
 }
 
-/* Destroys pml4e, freeing all the pages it references. */
+/* Destroys pml4e, freeing all the pages it references.
+ * Only the user entries are walked: the kernel's tables are shared
+ * with base_pml4 and stay. */
 void
 pml4_destroy (uint64_t *pml4) {
+	unsigned i;
+
 	if (pml4 == NULL)
 		return;
 	ASSERT (pml4 != base_pml4);
 
-	/* if PML4 (vaddr) >= 1, it's kernel space by define. */
-	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
-	if (((uint64_t) pdpe) & PTE_P)
-		pdpe_destroy ((void *) PTE_ADDR (pdpe));
-	palloc_free_page ((void *) pml4);
+	for (i = 0; i < KERN_PML4; i++) {
+		uint64_t *pdpe = ptov ((uint64_t *) pml4[i]);
+		if (((uint64_t) pdpe) & PTE_P)
+			pdpe_destroy ((void *) PTE_ADDR (pdpe));
+		pml4[i] = 0;
+	}
+	for (i = KERN_PML4; i < kern_pml4_end; i++)
+		pml4[i] = 0;
+	if (pcid_enabled)
+		pcid_forget (pml4);
+	pt_free ((void *) pml4);
 }
 
 /* Loads page directory PD into the CPU's page directory base
- * register. */
+ * register.  Global kernel mappings stay in the TLB, and so do PD's
+ * own if it still has its PCID (see tlb_init()). */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	uint64_t cr3 = vtop (pml4 ? pml4 : base_pml4);
+
+	if (pcid_enabled) {
+		enum intr_level old_level = intr_disable ();
+		lcr3 (cr3 | pcid_cr3_bits (pml4 ? pml4 : base_pml4));
+		intr_set_level (old_level);
+	} else
+		lcr3 (cr3);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -229,8 +449,8 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 /* Adds a mapping in page map level 4 PML4 from user virtual page
  * UPAGE to the physical frame identified by kernel virtual address KPAGE.
- * UPAGE must not already be mapped. KPAGE should probably be a page obtained
- * from the user pool with palloc_get_page().
+ * A mapping UPAGE already has is replaced. KPAGE should probably be a page
+ * obtained from the user pool with palloc_get_page().
  * If WRITABLE is true, the new page is read/write;
  * otherwise it is read-only.
  * Returns true if successful, false if memory allocation
@@ -244,8 +464,13 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		bool was_present = (*pte & PTE_P) != 0;
+
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (was_present)
+			tlb_flush_page (pml4, upage);
+	}
 	return pte != NULL;
 }
 
@@ -263,8 +488,7 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
 		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		tlb_flush_page (pml4, upage);
 	}
 }
 
@@ -287,10 +511,9 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		if (dirty)
 			*pte |= PTE_D;
 		else
-			*pte &= ~(uint32_t) PTE_D;
+			*pte &= ~(uint64_t) PTE_D;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_flush_page (pml4, vpage);
 	}
 }
 
@@ -313,9 +536,24 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		if (accessed)
 			*pte |= PTE_A;
 		else
-			*pte &= ~(uint32_t) PTE_A;
+			*pte &= ~(uint64_t) PTE_A;
+
+		tlb_flush_page (pml4, vpage);
+	}
+}
+
+/* Makes the PTE for virtual page VPAGE in PML4 read/write if
+ * WRITABLE is true, read-only otherwise.  The other bits, the
+ * accessed and dirty bits among them, are kept. */
+void
+pml4_set_writable (uint64_t *pml4, const void *vpage, bool writable) {
+	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
+	if (pte) {
+		if (writable)
+			*pte |= PTE_W;
+		else
+			*pte &= ~(uint64_t) PTE_W;
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_flush_page (pml4, vpage);
 	}
 }
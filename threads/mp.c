@@ -0,0 +1,320 @@
+#include "threads/mp.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#endif
+
+/* See [MP] "Intel MultiProcessor Specification", version 1.4,
+   chapter 4 and appendix B.4, and [IA32-v3a] chapter 10 "Advanced
+   Programmable Interrupt Controller". */
+
+/* MP floating pointer structure. */
+struct mp_fps {
+	char signature[4];          /* "_MP_". */
+	uint32_t config_addr;       /* Physical address of config table. */
+	uint8_t length;             /* In 16-byte units, always 1. */
+	uint8_t spec_rev;
+	uint8_t checksum;           /* All bytes add up to 0. */
+	uint8_t features[5];        /* features[0] != 0: default config. */
+} __attribute__ ((packed));
+
+/* MP configuration table header. */
+struct mp_config {
+	char signature[4];          /* "PCMP". */
+	uint16_t length;            /* Base table length, header included. */
+	uint8_t spec_rev;
+	uint8_t checksum;
+	char oem_id[8];
+	char product_id[12];
+	uint32_t oem_table_addr;
+	uint16_t oem_table_size;
+	uint16_t entry_cnt;         /* Entries that follow the header. */
+	uint32_t lapic_addr;        /* Physical address of the local APIC. */
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__ ((packed));
+
+/* Processor entry in the configuration table. */
+#define MP_PROCESSOR 0
+struct mp_processor {
+	uint8_t type;               /* MP_PROCESSOR. */
+	uint8_t lapic_id;
+	uint8_t lapic_version;
+	uint8_t flags;              /* MP_CPU_* below. */
+	uint32_t signature;
+	uint32_t features;
+	uint32_t reserved[2];
+} __attribute__ ((packed));
+#define MP_CPU_ENABLED 0x01     /* Usable. */
+#define MP_CPU_BSP 0x02         /* Bootstrap processor. */
+
+/* Every other entry type is 8 bytes long. */
+#define MP_ENTRY_SIZE 8
+
+/* Local APIC registers, as byte offsets. */
+#define LAPIC_ID 0x020          /* ID in bits 24...31. */
+#define LAPIC_SVR 0x0f0         /* Spurious interrupt vector. */
+#define LAPIC_ICR_LO 0x300      /* Interrupt command, low half. */
+#define LAPIC_ICR_HI 0x310      /* Interrupt command, high half. */
+
+#define LAPIC_SVR_ENABLE 0x100  /* APIC software enable. */
+#define ICR_INIT 0x00000500     /* INIT IPI. */
+#define ICR_STARTUP 0x00000600  /* STARTUP IPI, vector in bits 0...7. */
+#define ICR_PENDING 0x00001000  /* Delivery status: send pending. */
+#define ICR_ASSERT 0x00004000   /* Level: assert. */
+
+struct cpu cpus[MP_MAX_CPUS] = { [0] = { .started = true } };
+size_t mp_cpu_cnt = 1;
+size_t mp_cpu_started = 1;
+
+/* The local APIC, mapped uncached into base_pml4.  Every CPU sees
+   its own at the same address. */
+static volatile uint32_t *lapic;
+
+/* AP that mp_start_aps() is starting, for ap_main(). */
+static struct cpu *volatile ap_booting;
+
+void ap_main (void) NO_RETURN;
+
+/* Returns true if the SIZE bytes at P add up to 0. */
+static bool
+checksum_ok (const void *p, size_t size) {
+	const uint8_t *b = p;
+	uint8_t sum = 0;
+
+	while (size-- > 0)
+		sum += *b++;
+	return sum == 0;
+}
+
+/* Searches for the floating pointer structure in the SIZE bytes at
+   physical address PA, which lie on a 16-byte boundary. */
+static struct mp_fps *
+search (uint64_t pa, size_t size) {
+	uint8_t *p = ptov (pa);
+	uint8_t *end = p + size;
+
+	for (; p + sizeof (struct mp_fps) <= end; p += 16)
+		if (!memcmp (p, "_MP_", 4) && checksum_ok (p, sizeof (struct mp_fps)))
+			return (struct mp_fps *) p;
+	return NULL;
+}
+
+/* Finds the floating pointer structure in the places [MP] 4.1
+   lists: the first KB of the EBDA, the last KB of base memory,
+   and the BIOS ROM. */
+static struct mp_fps *
+find_fps (void) {
+	uint64_t ebda = (uint64_t) *(uint16_t *) ptov (0x40e) << 4;
+	uint64_t base_kb = *(uint16_t *) ptov (0x413);
+	struct mp_fps *fps = NULL;
+
+	if (ebda != 0)
+		fps = search (ebda, 1024);
+	if (fps == NULL)
+		fps = search (base_kb * 1024 - 1024, 1024);
+	if (fps == NULL)
+		fps = search (0xf0000, 0x10000);
+	return fps;
+}
+
+/* Adds the processor with local APIC ID LAPIC_ID to cpus[].  The
+   BSP always goes in cpus[0], the others after it in table order. */
+static void
+add_cpu (uint8_t lapic_id, bool bsp) {
+	struct cpu *cpu;
+
+	if (bsp)
+		cpu = &cpus[0];
+	else if (mp_cpu_cnt < MP_MAX_CPUS)
+		cpu = &cpus[mp_cpu_cnt++];
+	else {
+		printf ("mp: more than %d CPUs, ignoring LAPIC %d\n",
+				MP_MAX_CPUS, lapic_id);
+		return;
+	}
+	cpu->id = cpu - cpus;
+	cpu->lapic_id = lapic_id;
+}
+
+static uint32_t
+lapic_read (unsigned reg) {
+	return lapic[reg / sizeof *lapic];
+}
+
+static void
+lapic_write (unsigned reg, uint32_t value) {
+	lapic[reg / sizeof *lapic] = value;
+}
+
+/* Sends the interrupt command ICR to the CPU whose local APIC ID
+   is LAPIC_ID and waits for the local APIC to accept it. */
+static void
+lapic_ipi (uint8_t lapic_id, uint32_t icr) {
+	lapic_write (LAPIC_ICR_HI, (uint32_t) lapic_id << 24);
+	lapic_write (LAPIC_ICR_LO, icr);
+	while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+		continue;
+}
+
+/* Maps the local APIC at physical address PA into base_pml4,
+   with caching disabled, and enables it. */
+static void
+lapic_init (uint64_t pa) {
+	uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) ptov (pa), 1);
+
+	if (pte == NULL)
+		PANIC ("mp: out of memory mapping the local APIC");
+	*pte = pa | PTE_P | PTE_W | PTE_PCD | PTE_PWT | PTE_G;
+	lapic = ptov (pa);
+	lapic_write (LAPIC_SVR, lapic_read (LAPIC_SVR) | LAPIC_SVR_ENABLE);
+}
+
+/* Finds the processors listed in the MP tables and maps the local
+   APIC.  Leaves the thread fields of cpus[0], which thread_init()
+   and thread_start() fill in for the BSP, alone. */
+void
+mp_init (void) {
+	struct mp_fps *fps = find_fps ();
+	struct mp_config *conf;
+	uint8_t *entry;
+	int i;
+
+	if (fps == NULL) {
+		printf ("mp: no MP tables, assuming 1 CPU\n");
+		return;
+	}
+	if (fps->features[0] != 0) {
+		/* One of the default configurations, all of which have two
+		   processors with local APIC IDs 0 and 1 ([MP] chapter 5). */
+		add_cpu (0, true);
+		add_cpu (1, false);
+		lapic_init (0xfee00000);
+		printf ("mp: default configuration %d, 2 CPUs\n", fps->features[0]);
+		return;
+	}
+
+	conf = ptov (fps->config_addr);
+	if (memcmp (conf->signature, "PCMP", 4) || !checksum_ok (conf, conf->length)) {
+		printf ("mp: bad configuration table, assuming 1 CPU\n");
+		return;
+	}
+
+	entry = (uint8_t *) (conf + 1);
+	for (i = 0; i < conf->entry_cnt; i++) {
+		if (*entry == MP_PROCESSOR) {
+			struct mp_processor *cpu = (struct mp_processor *) entry;
+			if (cpu->flags & MP_CPU_ENABLED)
+				add_cpu (cpu->lapic_id, cpu->flags & MP_CPU_BSP);
+			entry += sizeof *cpu;
+		} else
+			entry += MP_ENTRY_SIZE;
+	}
+	lapic_init (conf->lapic_addr);
+
+	printf ("mp: %zu CPU%s found\n", mp_cpu_cnt, mp_cpu_cnt > 1 ? "s" : "");
+}
+
+/* Starts the application processors one at a time, each on an idle
+   thread of its own, with the INIT-SIPI-SIPI sequence of [MP] B.4.
+   Must be called with interrupts on, after timer_calibrate(). */
+void
+mp_start_aps (void) {
+	extern char ap_trampoline[], ap_trampoline_end[];
+	extern char ap_trampoline_cr3[], ap_trampoline_rsp[];
+	uint8_t *tramp = ptov (LOADER_AP_TRAMPOLINE);
+	uint64_t *cr3 = (uint64_t *) (tramp + (ap_trampoline_cr3 - ap_trampoline));
+	uint64_t *rsp = (uint64_t *) (tramp + (ap_trampoline_rsp - ap_trampoline));
+	size_t i;
+	int j;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	if (mp_cpu_cnt == 1)
+		return;
+
+	memcpy (tramp, ap_trampoline, ap_trampoline_end - ap_trampoline);
+	*cr3 = vtop (base_pml4);
+	for (i = 1; i < mp_cpu_cnt; i++) {
+		struct cpu *cpu = &cpus[i];
+		char name[16];
+
+		snprintf (name, sizeof name, "idle%d", cpu->id);
+		cpu->idle = thread_alloc_idle (name);
+		if (cpu->idle == NULL) {
+			printf ("mp: no memory for CPU %zu's idle thread\n", i);
+			break;
+		}
+		*rsp = (uint64_t) cpu->idle + PGSIZE;
+		ap_booting = cpu;
+
+		lapic_ipi (cpu->lapic_id, ICR_INIT | ICR_ASSERT);
+		timer_msleep (10);
+		for (j = 0; j < 2 && !cpu->started; j++) {
+			lapic_ipi (cpu->lapic_id,
+					ICR_STARTUP | ICR_ASSERT | (LOADER_AP_TRAMPOLINE >> PGBITS));
+			timer_usleep (200);
+		}
+		for (j = 0; j < 100 && !cpu->started; j++)
+			timer_msleep (1);
+
+		if (cpu->started)
+			mp_cpu_started++;
+		else
+			printf ("mp: CPU %zu (LAPIC %d) did not start\n",
+					i, cpu->lapic_id);
+	}
+	ap_booting = NULL;
+
+	printf ("mp: %zu of %zu CPUs started, scheduling on the BSP only\n",
+			mp_cpu_started, mp_cpu_cnt);
+}
+
+/* Entered from ap_entry_64 in start.S on the stack of the idle
+   thread that mp_start_aps() set up for the AP.  Only the BSP
+   schedules threads, so the AP marks itself started and parks with
+   interrupts off. */
+void
+ap_main (void) {
+	struct cpu *cpu = ap_booting;
+
+#ifdef USERPROG
+	gdt_load ();
+#endif
+	intr_init_ap ();
+
+	cpu->idle->status = THREAD_RUNNING;
+	cpu->curr = cpu->idle;
+	ASSERT (thread_current () == cpu->idle);
+	cpu->started = true;
+
+	for (;;)
+		asm volatile ("cli; hlt" : : : "memory");
+}
+
+/* Returns the running CPU. */
+struct cpu *
+cpu_current (void) {
+	uint8_t id;
+	size_t i;
+
+	if (mp_cpu_started == 1)
+		return &cpus[0];
+
+	id = lapic_read (LAPIC_ID) >> 24;
+	for (i = 0; i < mp_cpu_cnt; i++)
+		if (cpus[i].lapic_id == id)
+			return &cpus[i];
+	NOT_REACHED ();
+}
@@ -2,14 +2,17 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,15 +27,100 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, runs of contiguous pages are found by a buddy
+   allocator: free memory is kept as blocks of 2**N pages, aligned
+   to their size relative to the pool base, on one free list per
+   order N.  An allocation splits the smallest big enough block and
+   gives back whatever it does not need, and a free merges each
+   block with its buddy for as long as the buddy is free too, so
+   both take O(log n) time.  Build with PALLOC=bitmap (see
+   Make.config) to find runs with a scan of the pool's bitmap
+   instead.  Either way the bitmap records which pages are in use. */
+
+#ifndef PALLOC_BITMAP
+/* Free blocks have 2**0 through 2**(BUDDY_ORDERS - 1) pages. */
+#define BUDDY_ORDERS 17
+
+/* Buddy state of a page. */
+struct buddy_page {
+	struct list_elem elem;          /* In free_blocks[ORDER], if free. */
+	int order;                      /* Order of the free block this page
+	                                   starts, or BUDDY_NOT_FREE. */
+};
+#define BUDDY_NOT_FREE -1
+#endif
+
+/* A magazine: a small stack of free single pages kept in front of
+   a pool's allocator.  palloc_get_page() and palloc_free_page() work
+   on it with interrupts disabled instead of taking the pool lock,
+   and only go to the pool, MAG_BATCH pages at a time, to refill an
+   empty magazine or drain a full one.  A refill takes single pages
+   off the buddy free lists, splitting blocks as needed, and a drain
+   puts them back and merges them with their buddies; with
+   PALLOC=bitmap the refill scans the bitmap and the drain clears it
+   instead.  Pages in a magazine stay marked as used in the bitmap.
+
+   There would be one magazine per CPU, but only one CPU runs
+   threads, so each pool has just one. */
+#define MAG_SIZE 64                 /* Capacity of a magazine. */
+#define MAG_BATCH 32                /* Pages moved per refill or drain. */
+struct magazine {
+	size_t cnt;                     /* Number of pages in PAGES. */
+	void *pages[MAG_SIZE];          /* Free pages, most recently freed last. */
+};
+
+/* Pre-zeroed pages.  A kernel thread running at the lowest
+   priority, and so only when the CPU would otherwise be idle, takes
+   free pages from the user pool, zeroes them, and keeps up to
+   ZERO_TARGET of them aside.  PAL_ZERO requests for single user
+   pages take one of those and skip the memset().  The daemon goes
+   back to work once fewer than ZERO_LOW are left.  Pages that have
+   been zeroed ahead of time go to any request if the pool runs
+   out. */
+#define ZERO_TARGET 64              /* Zeroed pages to keep. */
+#define ZERO_LOW 32                 /* Refill below this many. */
+
+/* Pages freed with interrupts off, as schedule() frees a dying
+   thread's page, cannot take the pool lock, and the lock holder
+   may be in the middle of changing the bitmap or the free lists.
+   If the magazine is full they are parked on the pool's deferred
+   list instead, in a header written into the first freed page, and
+   given back by the next thread that locks the pool. */
+struct deferred_free {
+	struct deferred_free *next;     /* Next deferred run. */
+	size_t page_cnt;                /* Pages in this run. */
+};
 
 /* A memory pool. */
 struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+#ifdef PALLOC_BITMAP
+	size_t next_idx;                /* Where the next scan starts (next fit). */
+#else
+	struct buddy_page *pages;       /* Buddy state of each page. */
+	struct list free_blocks[BUDDY_ORDERS]; /* Free blocks by order. */
+#endif
+	struct magazine mag;            /* Free single pages. */
+	struct deferred_free *deferred; /* Freed with interrupts off. */
+	bool zeroing;                   /* Keep pre-zeroed pages? */
+	size_t zeroed_cnt;              /* Number of pages in ZEROED. */
+	void *zeroed[ZERO_TARGET];      /* Pre-zeroed free pages. */
+
+	/* Statistics. */
+	unsigned long long mag_hits;    /* Single pages served by MAG. */
+	unsigned long long mag_refills; /* Times MAG was refilled. */
+	unsigned long long mag_drains;  /* Times MAG was drained. */
+	unsigned long long zero_hits;   /* PAL_ZERO pages served by ZEROED. */
+	unsigned long long zero_misses; /* PAL_ZERO pages zeroed on demand. */
 };
 
+/* Wakes up the page-zeroing daemon. */
+static struct semaphore zero_wakeup;
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
@@ -42,6 +130,17 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_scan (struct pool *, size_t page_cnt);
+static void pool_free (struct pool *, void *pages, size_t page_cnt);
+static size_t mag_refill (struct pool *, void **pages);
+static void mag_drain (struct pool *, size_t cnt);
+static void pool_lock (struct pool *);
+static void pool_unlock (struct pool *);
+#ifndef PALLOC_BITMAP
+static void buddy_populate (struct pool *);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+#endif
 
 /* multiboot info */
 struct multiboot_info {
@@ -250,9 +349,394 @@ palloc_init (void) {
 	printf ("\text_mem: 0x%llx ~ 0x%llx (Usable: %'llu kB)\n",
 		  ext_mem.start, ext_mem.end, ext_mem.size / 1024);
 	populate_pools (&base_mem, &ext_mem);
+#ifndef PALLOC_BITMAP
+	buddy_populate (&kernel_pool);
+	buddy_populate (&user_pool);
+#endif
 	return ext_mem.end;
 }
 
+#ifndef PALLOC_BITMAP
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int
+buddy_order (size_t page_cnt) {
+	int order = 0;
+
+	while (((size_t) 1 << order) < page_cnt)
+		order++;
+	return order;
+}
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX on POOL's free
+   lists. */
+static void
+buddy_push (struct pool *pool, size_t page_idx, int order) {
+	struct buddy_page *bp = &pool->pages[page_idx];
+
+	bp->order = order;
+	list_push_front (&pool->free_blocks[order], &bp->elem);
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX, merging it with
+   its buddy for as long as the buddy is a free block of the same
+   order. */
+static void
+buddy_free_block (struct pool *pool, size_t page_idx, int order) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+
+	while (order + 1 < BUDDY_ORDERS) {
+		size_t buddy = page_idx ^ ((size_t) 1 << order);
+		struct buddy_page *bp = &pool->pages[buddy];
+
+		if (buddy >= page_cnt || bp->order != order)
+			break;
+		list_remove (&bp->elem);
+		bp->order = BUDDY_NOT_FREE;
+		page_idx &= ~((size_t) 1 << order);
+		order++;
+	}
+	buddy_push (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX, which need not form a
+   block, by freeing the largest aligned blocks they contain. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) {
+	while (page_cnt > 0) {
+		int order = 0;
+
+		while (order + 1 < BUDDY_ORDERS
+				&& page_idx % ((size_t) 2 << order) == 0
+				&& ((size_t) 2 << order) <= page_cnt)
+			order++;
+		buddy_free_block (pool, page_idx, order);
+		page_idx += (size_t) 1 << order;
+		page_cnt -= (size_t) 1 << order;
+	}
+}
+
+/* Takes PAGE_CNT contiguous pages off POOL's free lists and returns
+   the index of the first one, or BITMAP_ERROR.  Splits the smallest
+   free block that is big enough and frees the pages of it that are
+   not needed, so a request for 3 pages costs 3 pages, not 4. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) {
+	int order = buddy_order (page_cnt);
+	struct buddy_page *bp;
+	size_t page_idx;
+	int o;
+
+	for (o = order; o < BUDDY_ORDERS; o++)
+		if (!list_empty (&pool->free_blocks[o]))
+			break;
+	if (o >= BUDDY_ORDERS)
+		return BITMAP_ERROR;
+
+	bp = list_entry (list_pop_front (&pool->free_blocks[o]),
+			struct buddy_page, elem);
+	bp->order = BUDDY_NOT_FREE;
+	page_idx = bp - pool->pages;
+	while (o > order) {
+		o--;
+		buddy_push (pool, page_idx + ((size_t) 1 << o), o);
+	}
+	if (page_cnt < (size_t) 1 << order)
+		buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+	return page_idx;
+}
+
+/* Builds POOL's free lists from the free pages in its bitmap. */
+static void
+buddy_populate (struct pool *pool) {
+	size_t page_cnt = bitmap_size (pool->used_map);
+	size_t start = 0;
+
+	while ((start = bitmap_scan (pool->used_map, start, 1, false)) != BITMAP_ERROR) {
+		size_t end = bitmap_scan (pool->used_map, start, 1, true);
+		if (end == BITMAP_ERROR)
+			end = page_cnt;
+		buddy_free (pool, start, end - start);
+		start = end;
+	}
+}
+#endif
+
+/* Finds PAGE_CNT contiguous free pages in POOL, marks them used,
+   and returns the index of the first one, or BITMAP_ERROR.  POOL's
+   lock must be held.
+
+   Without the buddy allocator, scans the bitmap from where the
+   previous scan left off and wraps around once, so that allocations
+   do not keep going over the used pages at the start of the pool. */
+static size_t
+pool_scan (struct pool *pool, size_t page_cnt) {
+	size_t page_idx;
+
+	ASSERT (lock_held_by_current_thread (&pool->lock));
+
+#ifndef PALLOC_BITMAP
+	page_idx = buddy_alloc (pool, page_cnt);
+	if (page_idx != BITMAP_ERROR) {
+		ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+		bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+	}
+#else
+	page_idx = bitmap_scan_and_flip (pool->used_map, pool->next_idx, page_cnt, false);
+	if (page_idx == BITMAP_ERROR && pool->next_idx != 0)
+		page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if (page_idx != BITMAP_ERROR)
+		pool->next_idx = page_idx + page_cnt < bitmap_size (pool->used_map)
+			? page_idx + page_cnt : 0;
+#endif
+	return page_idx;
+}
+
+/* Returns the PAGE_CNT pages at PAGES to POOL.  POOL must
+   be locked with pool_lock(). */
+static void
+pool_free (struct pool *pool, void *pages, size_t page_cnt) {
+	size_t page_idx = pg_no (pages) - pg_no (pool->base);
+
+	ASSERT (lock_held_by_current_thread (&pool->lock));
+	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+#ifndef PALLOC_BITMAP
+	buddy_free (pool, page_idx, page_cnt);
+#endif
+}
+
+/* Parks the PAGE_CNT pages at PAGES on POOL's deferred list, for
+   a caller that cannot lock POOL because interrupts are off. */
+static void
+pool_defer (struct pool *pool, void *pages, size_t page_cnt) {
+	struct deferred_free *df = pages;
+	enum intr_level old_level = intr_disable ();
+
+	df->page_cnt = page_cnt;
+	df->next = pool->deferred;
+	pool->deferred = df;
+	intr_set_level (old_level);
+}
+
+/* Locks POOL and gives back the pages that were freed while it
+   could not be locked. */
+static void
+pool_lock (struct pool *pool) {
+	struct deferred_free *df;
+	enum intr_level old_level;
+
+	lock_acquire (&pool->lock);
+
+	old_level = intr_disable ();
+	df = pool->deferred;
+	pool->deferred = NULL;
+	intr_set_level (old_level);
+
+	while (df != NULL) {
+		struct deferred_free *next = df->next;
+		pool_free (pool, df, df->page_cnt);
+		df = next;
+	}
+}
+
+/* Unlocks POOL. */
+static void
+pool_unlock (struct pool *pool) {
+	lock_release (&pool->lock);
+}
+
+/* Takes up to MAG_BATCH free pages out of POOL into PAGES and
+   returns how many it got. */
+static size_t
+mag_refill (struct pool *pool, void **pages) {
+	size_t cnt;
+
+	pool_lock (pool);
+	for (cnt = 0; cnt < MAG_BATCH; cnt++) {
+		size_t page_idx = pool_scan (pool, 1);
+		if (page_idx == BITMAP_ERROR)
+			break;
+		pages[cnt] = pool->base + PGSIZE * page_idx;
+	}
+	pool->mag_refills++;
+	pool_unlock (pool);
+	return cnt;
+}
+
+/* Returns the CNT least recently freed pages in POOL's magazine to
+   the pool. */
+static void
+mag_drain (struct pool *pool, size_t cnt) {
+	void *pages[MAG_SIZE];
+	enum intr_level old_level;
+	size_t i;
+
+	old_level = intr_disable ();
+	if (cnt > pool->mag.cnt)
+		cnt = pool->mag.cnt;
+	memcpy (pages, pool->mag.pages, cnt * sizeof *pages);
+	pool->mag.cnt -= cnt;
+	memmove (pool->mag.pages, pool->mag.pages + cnt,
+			pool->mag.cnt * sizeof *pages);
+	intr_set_level (old_level);
+
+	pool_lock (pool);
+	for (i = 0; i < cnt; i++)
+		pool_free (pool, pages[i], 1);
+	pool->mag_drains++;
+	pool_unlock (pool);
+}
+
+/* Obtains a single free page from POOL's magazine, refilling it
+   from the pool if it is empty.  Returns a null pointer if the
+   pool is out of pages. */
+static void *
+mag_get (struct pool *pool) {
+	enum intr_level old_level;
+	void *pages[MAG_BATCH];
+	void *page = NULL;
+	size_t cnt, i;
+
+	old_level = intr_disable ();
+	if (pool->mag.cnt > 0) {
+		page = pool->mag.pages[--pool->mag.cnt];
+		pool->mag_hits++;
+	}
+	intr_set_level (old_level);
+	if (page != NULL)
+		return page;
+
+	/* Empty: keep one of a fresh batch and stock up with the rest.
+	   Someone else may have refilled the magazine meanwhile, so give
+	   back whatever does not fit. */
+	cnt = mag_refill (pool, pages);
+	if (cnt == 0)
+		return NULL;
+	page = pages[--cnt];
+
+	old_level = intr_disable ();
+	for (i = 0; i < cnt && pool->mag.cnt < MAG_SIZE; i++)
+		pool->mag.pages[pool->mag.cnt++] = pages[i];
+	intr_set_level (old_level);
+
+	if (i < cnt) {
+		pool_lock (pool);
+		for (; i < cnt; i++)
+			pool_free (pool, pages[i], 1);
+		pool_unlock (pool);
+	}
+	return page;
+}
+
+/* Puts free PAGE into POOL's magazine, draining it first if it is
+   full.  With interrupts off a full magazine cannot be drained, so
+   PAGE goes on the deferred list instead. */
+static void
+mag_put (struct pool *pool, void *page) {
+	for (;;) {
+		enum intr_level old_level = intr_disable ();
+		if (pool->mag.cnt < MAG_SIZE) {
+			pool->mag.pages[pool->mag.cnt++] = page;
+			intr_set_level (old_level);
+			return;
+		}
+		intr_set_level (old_level);
+		if (old_level == INTR_OFF) {
+			pool_defer (pool, page, 1);
+			return;
+		}
+		mag_drain (pool, MAG_BATCH);
+	}
+}
+
+/* Takes a pre-zeroed page from POOL, if it has any, and returns
+   it, or a null pointer.  COUNT says whether the page is for a
+   PAL_ZERO request, for statistics.  Wakes up the zeroing daemon
+   when the pages run low. */
+static void *
+zero_get (struct pool *pool, bool count) {
+	enum intr_level old_level;
+	void *page = NULL;
+	bool wake = false;
+
+	if (!pool->zeroing)
+		return NULL;
+
+	old_level = intr_disable ();
+	if (pool->zeroed_cnt > 0) {
+		page = pool->zeroed[--pool->zeroed_cnt];
+		wake = pool->zeroed_cnt == ZERO_LOW - 1;
+	}
+	if (count) {
+		if (page != NULL)
+			pool->zero_hits++;
+		else
+			pool->zero_misses++;
+	}
+	intr_set_level (old_level);
+
+	if (page == NULL || wake)
+		sema_up (&zero_wakeup);
+	return page;
+}
+
+/* Gives all of POOL's pre-zeroed pages back to it. */
+static void
+zero_drain (struct pool *pool) {
+	void *pages[ZERO_TARGET];
+	enum intr_level old_level;
+	size_t cnt, i;
+
+	old_level = intr_disable ();
+	cnt = pool->zeroed_cnt;
+	memcpy (pages, pool->zeroed, cnt * sizeof *pages);
+	pool->zeroed_cnt = 0;
+	intr_set_level (old_level);
+
+	for (i = 0; i < cnt; i++)
+		mag_put (pool, pages[i]);
+}
+
+/* Page-zeroing daemon for the user pool.  Runs at PRI_MIN, so it
+   only gets the CPU when nothing else wants it. */
+static void
+zero_daemon (void *aux UNUSED) {
+	struct pool *pool = &user_pool;
+
+	if (thread_mlfqs)
+		thread_set_nice (NICE_MAX);
+
+	for (;;) {
+		while (pool->zeroed_cnt < ZERO_TARGET) {
+			enum intr_level old_level;
+			void *page = mag_get (pool);
+
+			if (page == NULL)
+				break;
+			memset (page, 0, PGSIZE);
+
+			old_level = intr_disable ();
+			if (pool->zeroed_cnt < ZERO_TARGET) {
+				pool->zeroed[pool->zeroed_cnt++] = page;
+				page = NULL;
+			}
+			intr_set_level (old_level);
+			if (page != NULL)
+				mag_put (pool, page);
+		}
+		sema_down (&zero_wakeup);
+	}
+}
+
+/* Starts keeping pre-zeroed pages in the user pool.  Must be called
+   after thread_start(). */
+void
+palloc_zero_init (void) {
+	sema_init (&zero_wakeup, 0);
+	user_pool.zeroing = true;
+	thread_create ("pagezero", PRI_MIN, zero_daemon, NULL);
+}
+
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
@@ -262,19 +746,38 @@ palloc_init (void) {
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	void *pages = NULL;
 
-	lock_acquire (&pool->lock);
-	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-	lock_release (&pool->lock);
-	void *pages;
+	bool zeroed = false;
 
-	if (page_idx != BITMAP_ERROR)
-		pages = pool->base + PGSIZE * page_idx;
-	else
-		pages = NULL;
+	if (page_cnt == 1) {
+		if (flags & PAL_ZERO)
+			zeroed = (pages = zero_get (pool, true)) != NULL;
+		if (pages == NULL)
+			pages = mag_get (pool);
+		if (pages == NULL)
+			zeroed = (pages = zero_get (pool, false)) != NULL;
+	} else {
+		pool_lock (pool);
+		size_t page_idx = pool_scan (pool, page_cnt);
+		pool_unlock (pool);
+
+		/* The pages we need may be sitting in the magazine or among
+		   the pre-zeroed pages. */
+		if (page_idx == BITMAP_ERROR
+				&& (pool->mag.cnt > 0 || pool->zeroed_cnt > 0)) {
+			zero_drain (pool);
+			mag_drain (pool, MAG_SIZE);
+			pool_lock (pool);
+			page_idx = pool_scan (pool, page_cnt);
+			pool_unlock (pool);
+		}
+		if (page_idx != BITMAP_ERROR)
+			pages = pool->base + PGSIZE * page_idx;
+	}
 
 	if (pages) {
-		if (flags & PAL_ZERO)
+		if ((flags & PAL_ZERO) && !zeroed)
 			memset (pages, 0, PGSIZE * page_cnt);
 	} else {
 		if (flags & PAL_ASSERT)
@@ -300,7 +803,6 @@ palloc_get_page (enum palloc_flags flags) {
 void
 palloc_free_multiple (void *pages, size_t page_cnt) {
 	struct pool *pool;
-	size_t page_idx;
 
 	ASSERT (pg_ofs (pages) == 0);
 	if (pages == NULL || page_cnt == 0)
@@ -313,13 +815,18 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 	else
 		NOT_REACHED ();
 
-	page_idx = pg_no (pages) - pg_no (pool->base);
-
 #ifndef NDEBUG
 	memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
-	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	if (page_cnt == 1)
+		mag_put (pool, pages);
+	else if (intr_get_level () == INTR_OFF)
+		pool_defer (pool, pages, page_cnt);
+	else {
+		pool_lock (pool);
+		pool_free (pool, pages, page_cnt);
+		pool_unlock (pool);
+	}
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +835,76 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of pages in the largest run POOL can hand
+   out right now.  POOL's lock must be held. */
+static size_t
+pool_largest_free (struct pool *pool) {
+#ifndef PALLOC_BITMAP
+	int order;
+
+	for (order = BUDDY_ORDERS - 1; order >= 0; order--)
+		if (!list_empty (&pool->free_blocks[order]))
+			return (size_t) 1 << order;
+	return 0;
+#else
+	size_t page_cnt = bitmap_size (pool->used_map);
+	size_t largest = 0, start = 0;
+
+	while ((start = bitmap_scan (pool->used_map, start, 1, false)) != BITMAP_ERROR) {
+		size_t end = bitmap_scan (pool->used_map, start, 1, true);
+		if (end == BITMAP_ERROR)
+			end = page_cnt;
+		if (end - start > largest)
+			largest = end - start;
+		start = end;
+	}
+	return largest;
+#endif
+}
+
+/* Prints statistics for POOL, called NAME.  Fragmentation is the
+   share of free pages that are not in the largest free run, that
+   is, that a request as big as all free memory could not get. */
+static void
+pool_print_stats (const char *name, struct pool *pool) {
+	size_t free_cnt, largest;
+
+	pool_lock (pool);
+	free_cnt = bitmap_count (pool->used_map, 0, bitmap_size (pool->used_map), false);
+	largest = pool_largest_free (pool);
+
+	printf ("%s pool: %zu pages, %zu free, %zu in magazine; "
+			"%llu magazine hits, %llu refills, %llu drains\n",
+			name, bitmap_size (pool->used_map), free_cnt, pool->mag.cnt,
+			pool->mag_hits, pool->mag_refills, pool->mag_drains);
+	if (pool->zeroing)
+		printf ("%s pool: %zu pre-zeroed; %llu zeroed hits, %llu misses\n",
+				name, pool->zeroed_cnt, pool->zero_hits, pool->zero_misses);
+	printf ("%s pool: largest free run %zu pages, fragmentation %zu%%\n",
+			name, largest, free_cnt > 0 ? 100 - largest * 100 / free_cnt : 0);
+#ifndef PALLOC_BITMAP
+	int order;
+
+	printf ("%s pool: free blocks by order:", name);
+	for (order = 0; order < BUDDY_ORDERS; order++)
+		printf (" %zu", list_size (&pool->free_blocks[order]));
+	printf ("\n");
+#endif
+	pool_unlock (pool);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) {
+#ifndef PALLOC_BITMAP
+	printf ("Page allocator: buddy\n");
+#else
+	printf ("Page allocator: bitmap\n");
+#endif
+	pool_print_stats ("Kernel", &kernel_pool);
+	pool_print_stats ("User", &user_pool);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -337,14 +914,34 @@ init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
 	uint64_t pgcnt = (end - start) / PGSIZE;
 	size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (pgcnt), PGSIZE) * PGSIZE;
 
-	lock_init(&p->lock);
+	lock_init_adaptive(&p->lock);
 	p->used_map = bitmap_create_in_buf (pgcnt, *bm_base, bm_pages);
 	p->base = (void *) start;
+	p->mag.cnt = 0;
+	p->deferred = NULL;
+	p->zeroing = false;
+	p->zeroed_cnt = 0;
 
 	// Mark all to unusable.
 	bitmap_set_all(p->used_map, true);
 
 	*bm_base += bm_pages;
+
+#ifndef PALLOC_BITMAP
+	/* The buddy state goes right after the bitmap.  The free lists
+	   are filled in by buddy_populate() once the usable pages are
+	   known. */
+	size_t i;
+
+	p->pages = *bm_base;
+	for (i = 0; i < pgcnt; i++)
+		p->pages[i].order = BUDDY_NOT_FREE;
+	for (i = 0; i < BUDDY_ORDERS; i++)
+		list_init (&p->free_blocks[i]);
+	*bm_base += DIV_ROUND_UP (pgcnt * sizeof *p->pages, PGSIZE) * PGSIZE;
+#else
+	p->next_idx = 0;
+#endif
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,321 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator for kernel objects of a fixed size.
+
+   Each kind of object gets a cache, made with kmem_cache_create().
+   A cache carves pages from the page allocator, called slabs, into
+   as many objects as fit after a small header.  Slabs sit on one of
+   three lists by how many of their objects are in use, and objects
+   are handed out from partially used slabs first, so that the
+   objects of a cache stay packed into as few pages as possible.
+
+   An object is constructed, by the cache's constructor, only when
+   its slab is created, not every time it is allocated.  Whoever
+   frees an object must leave it in its constructed state, so that
+   the next kmem_cache_alloc() can return it as is.  The link that
+   chains free objects together is therefore kept after each object
+   instead of inside it.
+
+   In front of the slabs, each cache keeps a per-CPU array of
+   recently freed objects, worked on with interrupts disabled, and
+   only goes to the slabs under the cache lock to move KMEM_BATCH
+   objects in or out at a time.  Only one CPU runs threads, so
+   there is one such array per cache.
+
+   A cache keeps one empty slab around rather than giving it back to
+   the page allocator right away, so that a single object being
+   allocated and freed over and over does not allocate and free a
+   page each time. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+#define KMEM_CPU_SIZE 16                /* Capacity of a per-CPU array. */
+#define KMEM_BATCH 8                    /* Objects moved per refill or drain. */
+#define KMEM_EMPTY_MAX 1                /* Empty slabs a cache keeps. */
+
+/* Recently freed objects of a cache. */
+struct kmem_cpu {
+	size_t cnt;                         /* Number of objects in OBJS. */
+	void *objs[KMEM_CPU_SIZE];          /* Free objects, most recent last. */
+};
+
+/* An object cache. */
+struct kmem_cache {
+	const char *name;                   /* For statistics. */
+	size_t obj_size;                    /* Size requested by the creator. */
+	size_t slot_size;                   /* Object plus free link, rounded up. */
+	size_t objs_per_slab;               /* Objects in a slab. */
+	kmem_ctor *ctor;                    /* Constructor, or null. */
+
+	struct lock lock;                   /* Protects the members below. */
+	struct list partial;                /* Slabs with used and free objects. */
+	struct list full;                   /* Slabs with no free objects. */
+	struct list empty;                  /* Slabs with no used objects. */
+	size_t empty_cnt;                   /* Slabs in EMPTY. */
+	size_t slab_cnt;                    /* Slabs in all three lists. */
+
+	struct kmem_cpu cpu;                /* Per-CPU free objects. */
+	struct list_elem elem;              /* In caches. */
+
+	/* Statistics. */
+	unsigned long long alloc_cnt;       /* Calls to kmem_cache_alloc(). */
+	unsigned long long cpu_hits;        /* Of those, served by CPU. */
+};
+
+/* A slab, at the start of its page. */
+struct slab {
+	unsigned magic;                     /* Always set to SLAB_MAGIC. */
+	struct kmem_cache *cache;           /* Owning cache. */
+	struct list_elem elem;              /* In one of the cache's lists. */
+	size_t used_cnt;                    /* Objects in use or in CPU. */
+	void *free;                         /* First free object, or null. */
+};
+
+/* All caches, for statistics. */
+static struct list caches;
+
+/* Initializes the slab allocator. */
+void
+kmem_init (void) {
+	list_init (&caches);
+}
+
+/* Returns a pointer to the free link of OBJ in cache C. */
+static void **
+obj_link (struct kmem_cache *c, void *obj) {
+	return (void **) ((uint8_t *) obj + c->slot_size - sizeof (void *));
+}
+
+/* Returns the slab that OBJ, an object of cache C, is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj) {
+	struct slab *s = pg_round_down (obj);
+
+	ASSERT (s->magic == SLAB_MAGIC);
+	ASSERT (s->cache == c);
+	ASSERT ((pg_ofs (obj) - ROUND_UP (sizeof *s, sizeof (void *)))
+			% c->slot_size == 0);
+	return s;
+}
+
+/* Creates and returns a cache of objects of SIZE bytes named NAME.
+   CTOR, if nonnull, is called on each object when its slab is
+   created.  Panics if memory is not available, since caches are
+   created at initialization time. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor *ctor) {
+	struct kmem_cache *c = malloc (sizeof *c);
+	size_t header = ROUND_UP (sizeof (struct slab), sizeof (void *));
+
+	if (c == NULL)
+		PANIC ("kmem_cache_create: out of memory creating %s", name);
+
+	c->name = name;
+	c->obj_size = size;
+	c->slot_size = ROUND_UP (size, sizeof (void *)) + sizeof (void *);
+	c->objs_per_slab = (PGSIZE - header) / c->slot_size;
+	c->ctor = ctor;
+	ASSERT (c->objs_per_slab > 0);
+
+	lock_init (&c->lock);
+	list_init (&c->partial);
+	list_init (&c->full);
+	list_init (&c->empty);
+	c->empty_cnt = 0;
+	c->slab_cnt = 0;
+	c->cpu.cnt = 0;
+	c->alloc_cnt = 0;
+	c->cpu_hits = 0;
+	list_push_back (&caches, &c->elem);
+	return c;
+}
+
+/* Allocates a new slab for cache C, constructs its objects, and
+   puts it on C's empty list.  Returns false if no page is
+   available.  C's lock must be held. */
+static bool
+slab_grow (struct kmem_cache *c) {
+	struct slab *s = palloc_get_page (0);
+	uint8_t *obj;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&c->lock));
+	if (s == NULL)
+		return false;
+
+	s->magic = SLAB_MAGIC;
+	s->cache = c;
+	s->used_cnt = 0;
+	s->free = NULL;
+	obj = (uint8_t *) s + ROUND_UP (sizeof *s, sizeof (void *));
+	obj += (c->objs_per_slab - 1) * c->slot_size;
+	for (i = 0; i < c->objs_per_slab; i++, obj -= c->slot_size) {
+		if (c->ctor != NULL)
+			c->ctor (obj);
+		*obj_link (c, obj) = s->free;
+		s->free = obj;
+	}
+
+	list_push_back (&c->empty, &s->elem);
+	c->empty_cnt++;
+	c->slab_cnt++;
+	return true;
+}
+
+/* Takes an object out of cache C's slabs, growing C if all of them
+   are full.  Returns a null pointer if memory is not available.
+   C's lock must be held. */
+static void *
+slab_get (struct kmem_cache *c) {
+	struct slab *s;
+	void *obj;
+
+	if (list_empty (&c->partial)) {
+		if (list_empty (&c->empty) && !slab_grow (c))
+			return NULL;
+		s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+		c->empty_cnt--;
+		list_push_front (&c->partial, &s->elem);
+	}
+
+	s = list_entry (list_front (&c->partial), struct slab, elem);
+	obj = s->free;
+	s->free = *obj_link (c, obj);
+	if (++s->used_cnt == c->objs_per_slab) {
+		list_remove (&s->elem);
+		list_push_front (&c->full, &s->elem);
+	}
+	return obj;
+}
+
+/* Returns OBJ to its slab in cache C, and the slab to the page
+   allocator if it is now empty and C already has enough empty
+   slabs.  C's lock must be held. */
+static void
+slab_put (struct kmem_cache *c, void *obj) {
+	struct slab *s = obj_to_slab (c, obj);
+
+	*obj_link (c, obj) = s->free;
+	s->free = obj;
+	list_remove (&s->elem);
+	if (--s->used_cnt > 0)
+		list_push_front (&c->partial, &s->elem);
+	else if (c->empty_cnt < KMEM_EMPTY_MAX) {
+		list_push_front (&c->empty, &s->elem);
+		c->empty_cnt++;
+	} else {
+		c->slab_cnt--;
+		s->magic = 0;
+		palloc_free_page (s);
+	}
+}
+
+/* Allocates and returns an object from cache C, in its constructed
+   state.  Returns a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) {
+	enum intr_level old_level;
+	void *objs[KMEM_BATCH];
+	void *obj = NULL;
+	size_t cnt, i;
+
+	old_level = intr_disable ();
+	c->alloc_cnt++;
+	if (c->cpu.cnt > 0) {
+		obj = c->cpu.objs[--c->cpu.cnt];
+		c->cpu_hits++;
+	}
+	intr_set_level (old_level);
+	if (obj != NULL)
+		return obj;
+
+	/* Keep one object of a fresh batch and stash the rest. */
+	lock_acquire (&c->lock);
+	for (cnt = 0; cnt < KMEM_BATCH; cnt++)
+		if ((objs[cnt] = slab_get (c)) == NULL)
+			break;
+	lock_release (&c->lock);
+	if (cnt == 0)
+		return NULL;
+	obj = objs[--cnt];
+
+	old_level = intr_disable ();
+	for (i = 0; i < cnt && c->cpu.cnt < KMEM_CPU_SIZE; i++)
+		c->cpu.objs[c->cpu.cnt++] = objs[i];
+	intr_set_level (old_level);
+
+	if (i < cnt) {
+		lock_acquire (&c->lock);
+		for (; i < cnt; i++)
+			slab_put (c, objs[i]);
+		lock_release (&c->lock);
+	}
+	return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C and be
+   back in its constructed state, to C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) {
+	enum intr_level old_level;
+	void *objs[KMEM_BATCH];
+	size_t i;
+
+	if (obj == NULL)
+		return;
+	obj_to_slab (c, obj);
+
+#ifndef NDEBUG
+	/* Clear the object to help detect use-after-free bugs, unless
+	   that would undo its constructor. */
+	if (c->ctor == NULL)
+		memset (obj, 0xcc, c->obj_size);
+#endif
+
+	old_level = intr_disable ();
+	if (c->cpu.cnt < KMEM_CPU_SIZE) {
+		c->cpu.objs[c->cpu.cnt++] = obj;
+		intr_set_level (old_level);
+		return;
+	}
+
+	/* Full: hand the oldest batch back to the slabs. */
+	memcpy (objs, c->cpu.objs, sizeof objs);
+	c->cpu.cnt -= KMEM_BATCH;
+	memmove (c->cpu.objs, c->cpu.objs + KMEM_BATCH,
+			c->cpu.cnt * sizeof *c->cpu.objs);
+	c->cpu.objs[c->cpu.cnt++] = obj;
+	intr_set_level (old_level);
+
+	lock_acquire (&c->lock);
+	for (i = 0; i < KMEM_BATCH; i++)
+		slab_put (c, objs[i]);
+	lock_release (&c->lock);
+}
+
+/* Prints statistics for every cache. */
+void
+kmem_cache_print_stats (void) {
+	struct list_elem *e;
+
+	for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) {
+		struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+		printf ("Cache %s: %zu-byte objects, %zu per slab, %zu slabs; "
+				"%llu allocs, %llu from CPU array\n",
+				c->name, c->obj_size, c->objs_per_slab, c->slab_cnt,
+				c->alloc_cnt, c->cpu_hits);
+	}
+}
@@ -1,9 +1,20 @@
 #include "threads/synch.h"
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+static int effective_priority(struct thread *t);
+static int rw_donated_priority(struct thread *t);
+static bool donor_more(const struct heap_elem *a, const struct heap_elem *b, void *aux);
+static void donation_propagate(struct thread *t);
+static void rw_holders_update(struct rwlock *rw);
+static void rw_donate(struct rwlock *rw);
+static void lock_grant(struct lock *lock);
+static bool sema_waiter_more(const struct heap_elem *a, const struct heap_elem *b, void *aux);
+static bool cond_waiter_more(const struct heap_elem *a, const struct heap_elem *b, void *aux);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -21,8 +32,8 @@ void
 sema_init (struct semaphore *sema, unsigned value) {
 	ASSERT (sema != NULL);
 	sema->value = value;
-	// 해당 sema를 리스트의 첫째 자리에 넣는다.
-	list_init (&sema->waiters);
+	// waiters는 priority가 가장 높은 스레드가 top에 오는 heap이다.
+	heap_init (&sema->waiters, sema_waiter_more, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -52,9 +63,11 @@ sema_down (struct semaphore *sema) {
 
 	old_level = intr_disable ();
 	while (sema->value == 0) {
-		// list_push_back (&sema->waiters, &thread_current ()->elem);
-		// 우선순위로 해야함
-		list_insert_ordered(&sema->waiters, &thread_current ()->elem, &cmp_priority, NULL);
+		// 우선순위 순으로 heap에 넣는다. 기다리는 동안 priority가 바뀌면
+		// thread_change_priority()가 wait_on_sema를 보고 위치를 고친다.
+		struct thread *curr = thread_current ();
+		curr->wait_on_sema = sema;
+		heap_push (&sema->waiters, &curr->sema_elem);
 		thread_block ();
 	}
 	sema->value--;
@@ -109,12 +122,13 @@ sema_up (struct semaphore *sema) {
 	old_level = intr_disable ();
 
 	/* ----------- project1 ------------ */
-	if (!list_empty (&sema->waiters)){
+	if (!heap_empty (&sema->waiters)){
 		// (Priority Scheduling-Synchronization)
-		// waiter list에 있는 쓰레드의 우선순위가 변경 되었을 경우를 고려하여 waiter list를 정렬 
-		list_sort(&sema->waiters, &cmp_priority, 0);
-		thread_unblock (list_entry (list_pop_front (&sema->waiters),
-					struct thread, elem));
+		// heap은 priority가 바뀔 때마다 갱신되므로 top이 가장 높은 우선순위의 스레드이다.
+		struct thread *t = heap_entry (heap_pop (&sema->waiters),
+					struct thread, sema_elem);
+		t->wait_on_sema = NULL;
+		thread_unblock (t);
 	}
 	/* --------------------------------- */
 
@@ -127,7 +141,7 @@ sema_up (struct semaphore *sema) {
 		if (intr_context()) {
 			intr_yield_on_return();
 		} else {
-			thread_yield();
+			thread_preempt();
 		}
 	}
 	intr_set_level (old_level);
@@ -201,6 +215,65 @@ lock_init (struct lock *lock) {
 
 	lock->holder = NULL;
 	sema_init (&lock->semaphore, 1);
+	lock->adaptive = false;
+	heap_init (&lock->donors, donor_more, NULL);
+}
+
+/* Initializes LOCK as an adaptive lock.  It behaves exactly like a
+   lock set up by lock_init(), except that lock_acquire() first
+   tries to wait out a short critical section instead of going to
+   sleep right away.  See lock_spin().
+
+   Use this for locks that are only ever held for a handful of
+   instructions, such as tid_lock or the palloc pool locks. */
+void
+lock_init_adaptive (struct lock *lock) {
+	lock_init (lock);
+	lock->adaptive = true;
+}
+
+/* Bounded wait for an adaptive LOCK.  Returns true if LOCK was
+   acquired, false if the caller should block in the usual way.
+
+   If the holder is running (possible only on another CPU), we
+   busy-wait.  If it was preempted and is sitting in the ready
+   queue at our priority or above, we yield so that it can finish
+   its critical section, which is much cheaper than blocking and
+   being woken up again.  A holder of lower priority cannot run
+   until it receives our priority, and a blocked holder will not
+   release the lock soon, so in those cases we stop trying and let
+   lock_acquire() donate and sleep as usual. */
+static bool
+lock_spin (struct lock *lock) {
+	int i;
+
+	for (i = 0; i < LOCK_SPIN_CNT; i++) {
+		enum intr_level old_level;
+		struct thread *holder;
+		bool yield = false;
+
+		if (sema_try_down (&lock->semaphore))
+			return true;
+
+		old_level = intr_disable ();
+		holder = lock->holder;
+		if (holder != NULL) {
+			if (holder->status == THREAD_READY
+					&& holder->priority >= thread_current ()->priority)
+				yield = true;
+			else if (holder->status != THREAD_RUNNING) {
+				intr_set_level (old_level);
+				return false;
+			}
+		}
+		intr_set_level (old_level);
+
+		if (yield)
+			thread_yield ();
+		else
+			barrier ();
+	}
+	return false;
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -226,21 +299,35 @@ lock_acquire (struct lock *lock) {
 
 	/* ----------- Project 1 ------------ */
 	struct thread *curr = thread_current();
-	// 만약 해당 lock을 누가 사용하고 있다면
-	if (lock->holder) {
+	enum intr_level old_level;
+	int64_t wait_start = timer_ticks ();
+
+	// adaptive lock이면 잠들기 전에 holder가 끝내기를 잠깐 기다려 본다.
+	// holder에게 yield 하며 기다린 시간도 lock_wait_ticks에 포함된다.
+	if (lock->adaptive && lock_spin (lock)) {
+		curr->stats.lock_wait_ticks += timer_ticks () - wait_start;
+		lock_grant (lock);
+		return;
+	}
+
+	// 기다려야 한다면 lock의 donors heap에 들어가고 holder에게 donation 한다.
+	// (MLFQS에서는 donation 하지 않는다)
+	old_level = intr_disable ();
+	if (!thread_mlfqs && lock->semaphore.value == 0) {
 		curr->wait_on_lock = lock;  // 현재 스레드의 wait_on_lock에 해당 lock을 저장한다.
-		// 지금 lock을 소유하고 있는 스레드의 donations에 현재 스레드를 저장한다.
-		list_push_back(&lock->holder->donation_list, &curr->donation_elem);
-		donate_priority();
+		heap_push (&lock->donors, &curr->donor_elem);
+		if (lock->holder != NULL) {
+			heap_update (&lock->holder->held_locks, &lock->holder_elem);
+			donation_propagate (lock->holder);
+		}
 	}
+	intr_set_level (old_level);
 	/* ---------------------------------- */
 	
 	sema_down (&lock->semaphore); // lock을 얻기 위해 기다리는중
 
-	/* ----------- Project 1 ------------ */
-	curr->wait_on_lock = NULL;		// lock을 획득했으므로 대기하고 있는 lock이 이제는 없다.
-	lock->holder = curr;
-	/* ---------------------------------- */
+	curr->stats.lock_wait_ticks += timer_ticks () - wait_start;
+	lock_grant (lock);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -263,7 +350,7 @@ lock_try_acquire (struct lock *lock) {
 
 	success = sema_try_down (&lock->semaphore);
 	if (success)
-		lock->holder = thread_current ();
+		lock_grant (lock);
 	return success;
 }
 
@@ -275,15 +362,23 @@ lock_try_acquire (struct lock *lock) {
    handler. */
 void
 lock_release (struct lock *lock) {
+	enum intr_level old_level;
+
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
 	/* ----------- Project 1 ------------ */
-	remove_donation_list_elem(lock);  // donations 리스트에서 해당 lock을 필요로 하는 스레드를 없애준다.
-	refresh_priority();		// 현재 스레드의 priority를 업데이트한다.
-	/* ---------------------------------- */
+	// lock의 donors는 lock에 남아 다음 holder에게 넘어간다.
+	// 현재 스레드는 held_locks에서 lock 하나만 빼면 된다.
+	old_level = intr_disable ();
+	heap_remove (&thread_current ()->held_locks, &lock->holder_elem);
+	if (!thread_mlfqs)
+		refresh_priority();		// 현재 스레드의 priority를 업데이트한다.
 
 	lock->holder = NULL;	// lock의 holder를 NULL로.
+	intr_set_level (old_level);
+	/* ---------------------------------- */
+
 	sema_up (&lock->semaphore);  // sema를 UP 시켜 해당 lock에서 기다리고 있는 스레드 하나를 깨운다.
 }
 
@@ -297,10 +392,12 @@ lock_held_by_current_thread (const struct lock *lock) {
 	return lock->holder == thread_current ();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition variable's waiters heap. */
 struct semaphore_elem {
-	struct list_elem elem;              /* List element. */
+	struct heap_elem elem;              /* Heap element. */
 	struct semaphore semaphore;         /* This semaphore. */
+	struct thread *thread;              /* Thread waiting on it. */
+	struct condition *cond;             /* Condition variable waited on. */
 };
 
 /* Initializes condition variable COND.  A condition variable
@@ -315,7 +412,7 @@ void
 cond_init (struct condition *cond) {
 	ASSERT (cond != NULL);
 
-	list_init (&cond->waiters);
+	heap_init (&cond->waiters, cond_waiter_more, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -354,6 +451,8 @@ cond_init (struct condition *cond) {
 void
 cond_wait (struct condition *cond, struct lock *lock) {
 	struct semaphore_elem waiter;
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
 
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
@@ -361,7 +460,14 @@ cond_wait (struct condition *cond, struct lock *lock) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	sema_init (&waiter.semaphore, 0);
-	list_push_back (&cond->waiters, &waiter.elem);
+	waiter.thread = curr;
+	waiter.cond = cond;
+
+	// timer interrupt(MLFQS)에서도 priority가 바뀌며 heap을 건드리므로 인터럽트를 끈다.
+	old_level = intr_disable ();
+	curr->cond_waiter = &waiter;
+	heap_push (&cond->waiters, &waiter.elem);
+	intr_set_level (old_level);
 	lock_release (lock);
 
 	sema_down (&waiter.semaphore);
@@ -378,9 +484,8 @@ cond_wait (struct condition *cond, struct lock *lock) {
    interrupt handler. */
 
 
-// 여기서는 중간에 우선순위가 바뀌었을 수 있으니 
-// waiters list 내 우선순위를 점검하고(list_sort),
-// 그 다음 리스트 맨 앞에 있는 우선순위가 가장 높은 스레드에 대해 sema_up을 실행한다.
+// waiters heap은 기다리는 스레드의 priority가 바뀔 때마다 갱신되므로
+// top에 있는 우선순위가 가장 높은 스레드에 대해 바로 sema_up을 실행한다.
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (cond != NULL);
@@ -389,11 +494,18 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED) {
 	ASSERT (lock_held_by_current_thread (lock));
 
 	/* ----------- Project 1 ------------ */
-	if (!list_empty (&cond->waiters)){
-		list_sort(&cond->waiters, &cmp_sem_priority, NULL);
-		sema_up (&list_entry (list_pop_front (&cond->waiters),
-					struct semaphore_elem, elem)->semaphore);
+	struct semaphore_elem *waiter = NULL;
+	enum intr_level old_level = intr_disable ();
+
+	if (!heap_empty (&cond->waiters)){
+		waiter = heap_entry (heap_pop (&cond->waiters),
+					struct semaphore_elem, elem);
+		waiter->thread->cond_waiter = NULL;
 	}
+	intr_set_level (old_level);
+
+	if (waiter != NULL)
+		sema_up (&waiter->semaphore);
 	/* ---------------------------------- */
 }
 
@@ -408,64 +520,129 @@ cond_broadcast (struct condition *cond, struct lock *lock) {
 	ASSERT (cond != NULL);
 	ASSERT (lock != NULL);
 
-	while (!list_empty (&cond->waiters))
+	while (!heap_empty (&cond->waiters))
 		cond_signal (cond, lock);
 }
 
 /* ------------ project 1 ------------ */
-/* compare thread priority value in condition variable
-  1. make semaphore_elem by elem *a and *b
-  2. get semaphore's waiters by semaphore_elem
-  3. get thread priority of first thread of semaphore's waiters 
-  compare and return
- */
-static bool cmp_sem_priority(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED){
-	// semaphore_elem으로부터 각 semaphore_elem의 쓰레드 디스크립터를 획득.
-	struct semaphore_elem * sema_a = list_entry(a, struct semaphore_elem, elem);
-	struct semaphore_elem * sema_b = list_entry(b, struct semaphore_elem, elem);
-	
-	struct list_elem *sema_a_elem = list_begin(&(sema_a->semaphore.waiters));
-	struct list_elem *sema_b_elem = list_begin(&(sema_b->semaphore.waiters));
-
-	struct thread *sema_a_thread = list_entry(sema_a_elem, struct thread, elem);
-	struct thread *sema_b_thread = list_entry(sema_b_elem, struct thread, elem);
+/* orders a semaphore's waiters by **sema_elem**, highest priority first */
+static bool
+sema_waiter_more (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+	return heap_entry (a, struct thread, sema_elem)->priority
+			> heap_entry (b, struct thread, sema_elem)->priority;
+}
 
-	// 첫 번째 인자의 우선순위가 두 번째 인자의 우선순위보다 높으면 1을 반환 낮으면 0을반환
-	return (sema_a_thread->priority > sema_b_thread->priority);
+/* orders a condition variable's waiters by the priority of the
+   thread waiting on each semaphore_elem, highest first */
+static bool
+cond_waiter_more (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+	return heap_entry (a, struct semaphore_elem, elem)->thread->priority
+			> heap_entry (b, struct semaphore_elem, elem)->thread->priority;
 }
 
+/* T's priority has just changed.  Moves T to its new place among
+   the waiters of the semaphore it is blocked on, of the condition
+   variable it waits for, among the donors of the lock it waits for
+   and among the waiters of the reader-writer lock it waits for, if
+   any.  T may still be running or ready, since it joins the condition
+   variable and lock heaps before it blocks.  Must be called with
+   interrupts off. */
+void
+sema_waiter_update (struct thread *t) {
+	struct lock *lock = t->wait_on_lock;
+	struct rw_hold *hold = t->wait_on_rw;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (t->wait_on_sema != NULL)
+		heap_update (&t->wait_on_sema->waiters, &t->sema_elem);
+	if (t->cond_waiter != NULL)
+		heap_update (&t->cond_waiter->cond->waiters, &t->cond_waiter->elem);
+	if (lock != NULL) {
+		heap_update (&lock->donors, &t->donor_elem);
+		if (lock->holder != NULL)
+			heap_update (&lock->holder->held_locks, &lock->holder_elem);
+	}
+	if (hold != NULL) {
+		heap_update (hold->write ? &hold->rw->write_waiters : &hold->rw->read_waiters,
+				&hold->wait_elem);
+		rw_holders_update (hold->rw);
+	}
+}
 
-/* if current thread want to acqurie lock and there is lock holder,
-	donate current thread priority to every single thread that lock holder is waiting for 
-	( depth limit = 8 according to test case ) */
-void donate_priority(void) {
-	int depth;
-	struct thread* curr = thread_current();
-	struct thread* holder = curr->wait_on_lock->holder;
+/* Makes the current thread the holder of LOCK, which it has just
+   acquired.  If it had been waiting for LOCK it stops donating to
+   it, and it now receives the donations of the threads still
+   waiting. */
+static void
+lock_grant (struct lock *lock) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level = intr_disable ();
 
-	for (depth = 0; depth < 8; depth++) {
-		if (!curr->wait_on_lock) break;
-		holder = curr->wait_on_lock->holder;
-		holder->priority = curr->priority;
-		curr = holder;
+	if (curr->wait_on_lock == lock) {
+		heap_remove (&lock->donors, &curr->donor_elem);
+		curr->wait_on_lock = NULL;
 	}
+	lock->holder = curr;
+	heap_push (&curr->held_locks, &lock->holder_elem);
+	if (!thread_mlfqs)
+		refresh_priority ();
+	intr_set_level (old_level);
 }
 
-/* when current thread release THIS LOCK(argument struct lock *lock),
- the current thread remove only threads which want THIS LOCK in the current thread's donation_list.
- In which if current thread's donation list is not empty, it means current thread holds another lock. */
-void remove_donation_list_elem(struct lock *lock){
-	struct thread *curr = thread_current();
+/* Returns the highest priority among the threads waiting for LOCK,
+   or PRI_MIN if there are none. */
+static int
+lock_donated_priority (const struct lock *lock) {
+	struct heap_elem *top = heap_top (&lock->donors);
+	return top != NULL ? heap_entry (top, struct thread, donor_elem)->priority : PRI_MIN;
+}
 
-	if (!list_empty(&curr->donation_list)) {
-		struct list_elem *e = list_begin(&curr->donation_list);
-		
-		for (e; e != list_end(&curr->donation_list); e = list_next(e)){
-			struct thread *t = list_entry(e, struct thread, donation_elem);
-			if (lock == t->wait_on_lock){
-				list_remove(&t->donation_elem);
-			}
+/* orders a lock's donors by **donor_elem**, highest priority first */
+static bool
+donor_more (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+	return heap_entry (a, struct thread, donor_elem)->priority
+			> heap_entry (b, struct thread, donor_elem)->priority;
+}
+
+/* orders a thread's held_locks by **holder_elem**, the lock with the
+   highest priority waiter first */
+bool
+held_lock_more (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+	return lock_donated_priority (heap_entry (a, struct lock, holder_elem))
+			> lock_donated_priority (heap_entry (b, struct lock, holder_elem));
+}
+
+/* The donations T receives have changed.  Recomputes T's priority
+   and, if it moved, repositions T among the donors of the lock it
+   waits for and carries on with that lock's holder, or with every
+   holder of the reader-writer lock it waits for.  Stops at the
+   first thread whose priority stays the same, so there is no need
+   for a depth limit: every step costs O(log n) and the walk cannot
+   outgrow the chains of waiting threads. */
+static void
+donation_propagate (struct thread *t) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	while (t != NULL) {
+		int priority = effective_priority (t);
+		struct lock *lock = t->wait_on_lock;
+		struct rw_hold *hold = t->wait_on_rw;
+
+		if (priority == t->priority)
+			break;
+		if (priority > t->priority)
+			t->stats.donations++;
+		/* This also moves T among the waiters of LOCK or HOLD's
+		   rwlock, and that lock among its holders' held locks. */
+		thread_change_priority (t, priority);
+		if (hold != NULL) {
+			rw_donate (hold->rw);
+			break;
 		}
+		if (lock == NULL)
+			break;
+		t = lock->holder;
 	}
 }
 
@@ -475,20 +652,282 @@ void remove_donation_list_elem(struct lock *lock){
 	현재 스레드 우선 순위를 재설정합니다.
 	커런트 스레드에 기부된 스레드가 있으면 더 큰 우선 순위를 찾아 현재 스레드 우선 순위로 설정합니다.
 	그렇지 않으면 현재 우선 순위를 초기 우선 순위로 설정합니다.
+
+	The current thread may already be in a condition variable's
+	waiters (cond_wait() pushes it before releasing the lock), so the
+	change goes through thread_change_priority() to reposition it.
 	*/
 void refresh_priority(void){
 	struct thread *curr = thread_current();
-	curr->priority = curr->initial_priority;
-
-	if (!list_empty(&curr->donation_list)){
-		list_sort(&curr->donation_list, &thread_donate_priority_compare, NULL);
-		
-		struct list_elem *donated_e = list_front(&curr->donation_list);
+	thread_change_priority(curr, effective_priority(curr));
+}
 
-		int max_donated_priority = list_entry(donated_e, struct thread, donation_elem)->priority;
-		if (curr->priority<max_donated_priority) {
-			curr->priority = max_donated_priority;
+/* returns T's initial priority raised by every donation T currently receives:
+	from threads waiting on locks T holds, and from threads waiting on
+	reader-writer locks T holds. */
+static int effective_priority(struct thread *t){
+	int priority = t->initial_priority;
+
+	// held_locks의 top이 가장 높은 priority의 donor를 가진 lock이다.
+	if (!heap_empty(&t->held_locks)){
+		struct lock *lock = heap_entry(heap_top(&t->held_locks), struct lock, holder_elem);
+		int max_donated_priority = lock_donated_priority(lock);
+		if (priority<max_donated_priority) {
+			priority = max_donated_priority;
 		}
 	}
+
+	int rw_priority = rw_donated_priority(t);
+	if (priority < rw_priority)
+		priority = rw_priority;
+	return priority;
+}
+/* ------------------- project 1 functions end ------------------------------- */
+
+/* Returns the priority of the thread waiting on the top of
+   WAITERS, a heap of struct rw_hold, or PRI_MIN if it is empty. */
+static int
+rw_waiters_priority (const struct heap *waiters) {
+	struct heap_elem *top = heap_top (waiters);
+	return top != NULL ? heap_entry (top, struct rw_hold, wait_elem)->thread->priority : PRI_MIN;
+}
+
+/* Returns the highest priority donated through HOLD: waiting
+   writers donate to every holder, and waiting readers donate to a
+   writing holder. */
+static int
+rw_hold_donated_priority (const struct rw_hold *hold) {
+	int priority = rw_waiters_priority (&hold->rw->write_waiters);
+
+	if (hold->write) {
+		int reader_priority = rw_waiters_priority (&hold->rw->read_waiters);
+		if (reader_priority > priority)
+			priority = reader_priority;
+	}
+	return priority;
+}
+
+/* orders a reader-writer lock's waiters by **wait_elem**, highest
+   priority first */
+static bool
+rw_waiter_more (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+	return heap_entry (a, struct rw_hold, wait_elem)->thread->priority
+			> heap_entry (b, struct rw_hold, wait_elem)->thread->priority;
+}
+
+/* orders a thread's rw_holds by **thread_elem**, the hold receiving
+   the highest donation first */
+bool
+rw_hold_more (const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED) {
+	return rw_hold_donated_priority (heap_entry (a, struct rw_hold, thread_elem))
+			> rw_hold_donated_priority (heap_entry (b, struct rw_hold, thread_elem));
+}
+
+/* Returns the highest priority donated to T through the
+   reader-writer locks it holds. */
+static int
+rw_donated_priority (struct thread *t) {
+	struct heap_elem *top = heap_top (&t->rw_holds);
+	return top != NULL
+			? rw_hold_donated_priority (heap_entry (top, struct rw_hold, thread_elem))
+			: PRI_MIN;
+}
+
+/* The waiters of RW have changed.  Moves each of RW's holds to its
+   new place among its thread's rw_holds. */
+static void
+rw_holders_update (struct rwlock *rw) {
+	struct list_elem *e;
+
+	for (e = list_begin (&rw->holds); e != list_end (&rw->holds); e = list_next (e)) {
+		struct rw_hold *h = list_entry (e, struct rw_hold, elem);
+		heap_update (&h->thread->rw_holds, &h->thread_elem);
+	}
+}
+
+/* Passes the donations of RW's waiters on to its holders. */
+static void
+rw_donate (struct rwlock *rw) {
+	struct list_elem *e;
+
+	for (e = list_begin (&rw->holds); e != list_end (&rw->holds); e = list_next (e))
+		donation_propagate (list_entry (e, struct rw_hold, elem)->thread);
+}
+
+/* Puts the current thread's HOLD on one of RW's waiter heaps, makes
+   it donate to RW's holders and blocks until rw_wake() grants HOLD.
+   Must be called with interrupts off. */
+static void
+rw_wait (struct rwlock *rw, struct rw_hold *hold) {
+	struct thread *curr = thread_current ();
+
+	heap_push (hold->write ? &rw->write_waiters : &rw->read_waiters, &hold->wait_elem);
+	curr->wait_on_rw = hold;
+	rw_holders_update (rw);
+	if (!thread_mlfqs)
+		rw_donate (rw);
+	thread_block ();
+}
+
+/* Makes HOLD, whose thread has just been given its lock, one of
+   the lock's holders. */
+static void
+rw_hold_add (struct rw_hold *hold) {
+	list_push_back (&hold->rw->holds, &hold->elem);
+	heap_push (&hold->thread->rw_holds, &hold->thread_elem);
+}
+
+/* Fills in HOLD as the current thread's hold on RW. */
+static void
+rw_hold_init (struct rw_hold *hold, struct rwlock *rw, bool write) {
+	hold->rw = rw;
+	hold->thread = thread_current ();
+	hold->write = write;
+}
+
+/* Initializes RW as an unheld reader-writer lock. */
+void
+rw_init (struct rwlock *rw) {
+	ASSERT (rw != NULL);
+
+	rw->readers = 0;
+	rw->writer = NULL;
+	list_init (&rw->holds);
+	heap_init (&rw->read_waiters, rw_waiter_more, NULL);
+	heap_init (&rw->write_waiters, rw_waiter_more, NULL);
+}
+
+/* Acquires RW for reading, sleeping until it becomes available if
+   necessary.  A reader has to wait while a writer holds RW, and
+   also while a writer of equal or higher priority is waiting for
+   it, so that a stream of readers cannot starve writers.  HOLD
+   records the hold and must stay valid until the matching
+   rw_release().
+
+   When this function returns because it was woken up, the waker
+   has already made us a holder of RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rw_read_acquire (struct rwlock *rw, struct rw_hold *hold) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (hold != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != curr);
+
+	rw_hold_init (hold, rw, false);
+	old_level = intr_disable ();
+	if (rw->writer != NULL || (!heap_empty (&rw->write_waiters)
+			&& rw_waiters_priority (&rw->write_waiters) >= curr->priority))
+		rw_wait (rw, hold);
+	else {
+		rw->readers++;
+		rw_hold_add (hold);
+	}
+	intr_set_level (old_level);
+}
+
+/* Acquires RW for writing, sleeping until it becomes available if
+   necessary.  While waiting, donates our priority to every thread
+   that holds RW.  HOLD records the hold and must stay valid until
+   the matching rw_release().
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rw_write_acquire (struct rwlock *rw, struct rw_hold *hold) {
+	struct thread *curr = thread_current ();
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (hold != NULL);
+	ASSERT (!intr_context ());
+	ASSERT (rw->writer != curr);
+
+	rw_hold_init (hold, rw, true);
+	old_level = intr_disable ();
+	if (rw->writer != NULL || rw->readers > 0)
+		rw_wait (rw, hold);
+	else {
+		rw->writer = curr;
+		rw_hold_add (hold);
+	}
+	intr_set_level (old_level);
+}
+
+/* Makes HOLD, just popped off one of RW's waiter heaps, a holder
+   of RW and wakes its thread up. */
+static void
+rw_grant (struct rwlock *rw, struct rw_hold *hold) {
+	struct thread *t = hold->thread;
+
+	t->wait_on_rw = NULL;
+	if (hold->write)
+		rw->writer = t;
+	else
+		rw->readers++;
+	rw_hold_add (hold);
+
+	/* T now receives donations from the threads still waiting. */
+	if (!thread_mlfqs)
+		thread_change_priority (t, effective_priority (t));
+	thread_unblock (t);
+}
+
+/* Hands RW, which nobody holds any more, to the threads waiting
+   for it.  The highest priority waiting writer gets it if it is at
+   least as important as every waiting reader.  Otherwise every
+   waiting reader that outranks all waiting writers gets it.  Must
+   be called with interrupts off. */
+static void
+rw_wake (struct rwlock *rw) {
+	int writer_priority = rw_waiters_priority (&rw->write_waiters);
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!heap_empty (&rw->write_waiters)
+			&& writer_priority >= rw_waiters_priority (&rw->read_waiters)) {
+		rw_grant (rw, heap_entry (heap_pop (&rw->write_waiters), struct rw_hold, wait_elem));
+		return;
+	}
+
+	while (!heap_empty (&rw->read_waiters)
+			&& (heap_empty (&rw->write_waiters)
+				|| rw_waiters_priority (&rw->read_waiters) > writer_priority))
+		rw_grant (rw, heap_entry (heap_pop (&rw->read_waiters), struct rw_hold, wait_elem));
+}
+
+/* Releases RW, which the current thread must hold for reading or
+   for writing through HOLD, the record it passed when acquiring
+   RW.  If that leaves RW unheld, hands it to the threads waiting
+   for it. */
+void
+rw_release (struct rwlock *rw, struct rw_hold *hold) {
+	enum intr_level old_level;
+
+	ASSERT (rw != NULL);
+	ASSERT (hold != NULL && hold->rw == rw);
+	ASSERT (hold->thread == thread_current ());
+	ASSERT (!intr_context ());
+
+	old_level = intr_disable ();
+	if (hold->write)
+		rw->writer = NULL;
+	else
+		rw->readers--;
+	list_remove (&hold->elem);
+	heap_remove (&thread_current ()->rw_holds, &hold->thread_elem);
+	hold->rw = NULL;
+
+	if (!thread_mlfqs)
+		refresh_priority ();
+	if (rw->writer == NULL && rw->readers == 0)
+		rw_wake (rw);
+	if (preempt_by_priority ())
+		thread_preempt ();
+	intr_set_level (old_level);
 }
-/* ------------------- project 1 functions end ------------------------------- */
\ No newline at end of file
@@ -4,11 +4,16 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
+#include "threads/fixed_point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
+#include "threads/mp.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 #ifdef USERPROG
@@ -24,13 +29,54 @@
 	 Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-	 that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+	 ready to run but not actually running, are kept in run queues,
+	 one per CPU once more than one runs threads, and until then one
+	 per scheduling domain of the boot CPU.  Each thread has a home
+	 queue that it goes back to whenever it becomes ready, so that it
+	 tends to stay where its cache is warm.
+
+	 Within a run queue there is one list per priority level, and bit
+	 P of its bitmap is set iff queues[P] is non-empty.  Each thread
+	 is stamped with a global sequence number when it becomes ready,
+	 and every list is kept in that order.
+
+	 Priority and FIFO order are still global: the scheduler runs the
+	 thread that became ready first among those of the highest
+	 priority ready anywhere, by comparing the heads of that level
+	 across the run queues, so a pick costs O(RQ_DOMAINS).  A run
+	 queue left empty by a pick steals the newest thread from the
+	 tail of the busiest peer, and thread_tick() evens out their
+	 lengths every RQ_BALANCE_TICKS.  Moving a thread keeps its
+	 sequence number, so neither changes the order threads run in,
+	 only which queue, and so which CPU, they are charged to. */
+#if PRI_MAX - PRI_MIN >= 64
+#error run_queue bitmap needs one bit per priority level
+#endif
+struct run_queue
+{
+	struct list queues[PRI_MAX - PRI_MIN + 1];
+	uint64_t bitmap;		/* Bit P set iff queues[P] is non-empty. */
+	size_t cnt;					/* # of threads in queues. */
+	int64_t busy_ticks; /* # of timer ticks its threads ran. */
+	int64_t steal_cnt;	/* # of threads pulled in from peers. */
+};
+
+#define RQ_DOMAINS 4					/* # of run queues on one CPU. */
+#define RQ_BALANCE_TICKS 16		/* # of timer ticks between rebalances. */
+static struct run_queue run_queues[RQ_DOMAINS];
+static int rq_cnt = 1;				/* # of run queues in use. */
+static uint64_t ready_seq;		/* Sequence number for the next ready thread. */
+static size_t ready_cnt;			/* # of threads in all run queues. */
+
+/* Every live thread except the ones already dying, for the
+	 once-a-second MLFQS recent_cpu update. */
+static struct list all_list;
 
 /* ----- project 1 ------------ */
-// THREAD_BLOCKED 상태의 스레드를 관리하기 위한 리스트 자료구조 추가 (Alarm Clock - sleep_list)
-static struct list sleep_list; /* sleep list for blocked threads */
+// THREAD_BLOCKED 상태의 스레드를 관리하기 위한 min-heap (Alarm Clock - sleep_heap)
+// wake_up_tick이 가장 작은 스레드가 top에 온다.
+static struct heap sleep_heap; /* sleeping threads ordered by wake_up_tick */
 /* --------------------------- */
 
 /* Idle thread. */
@@ -58,6 +104,12 @@ static unsigned thread_ticks; /* # of timer ticks since last yield. */
 static int64_t next_tick_to_awake; /* the earliest awake time in sleep list */
 /* --------------------------------- */
 
+/* MLFQS. */
+static fixed_t load_avg; /* system load average, 17.14 fixed-point */
+/* Threads whose recent_cpu has changed since their priority was
+	 last computed.  Only these are revisited every fourth tick. */
+static struct list mlfqs_dirty_list;
+
 /* If false (default), use round-robin scheduler.
 	 If true, use multi-level feedback queue scheduler.
 	 Controlled by kernel command-line option "-o mlfqs". */
@@ -72,13 +124,26 @@ static void do_schedule(int status);
 static void schedule(void);
 static tid_t allocate_tid(void);
 
+static void ready_queue_push(struct thread *);
+static void ready_queue_insert(struct thread *);
+static void ready_queue_remove(struct thread *);
+static struct thread *ready_queue_pop(void);
+static int ready_queue_max_priority(void);
+static int rq_load(int rq);
+static int rq_least_loaded(void);
+static void rq_migrate(int src, int dst);
+static void rq_steal(int dst);
+static void rq_balance(void);
+static bool wake_up_tick_less(const struct heap_elem *, const struct heap_elem *, void *aux);
+static int mlfqs_priority(struct thread *);
+static void mlfqs_update_recent_cpu(struct thread *);
+
 /* ------------------- project 1 -------------------- */
 void thread_sleep(int64_t ticks);
 void thread_awake(int64_t ticks);
 int64_t get_next_tick_to_awake(void);
 bool cmp_priority(struct list_elem *element1, struct list_elem *element2, void *aux UNUSED);
 bool preempt_by_priority(void);
-bool thread_donate_priority_compare(struct list_elem *element1, struct list_elem *element2, void *aux UNUSED);
 /* -------------------------------------------------- */
 /* ------------------- project 2 -------------------- */
 struct thread *get_child_by_tid(tid_t tid);
@@ -152,22 +217,34 @@ void thread_init(void)
 	lgdt(&gdt_ds);
 
 	/* Init the globla thread context */
-	lock_init(&tid_lock);
-	list_init(&ready_list);
+	lock_init_adaptive(&tid_lock);
+	for (int rq = 0; rq < RQ_DOMAINS; rq++)
+	{
+		for (int pri = PRI_MIN; pri <= PRI_MAX; pri++)
+			list_init(&run_queues[rq].queues[pri - PRI_MIN]);
+		run_queues[rq].bitmap = 0;
+		run_queues[rq].cnt = 0;
+	}
+	ready_cnt = 0;
+	list_init(&all_list);
 	list_init(&destruction_req);
 
 	/* ------------- project 1 ---------------- */
-	// sleep_list 초기화
-	list_init(&sleep_list);
+	// sleep_heap 초기화
+	heap_init(&sleep_heap, wake_up_tick_less, NULL);
 	// next_tick_to_awake 초기화
 	next_tick_to_awake = INT64_MAX;
 	/* ---------------------------------------- */
 
+	list_init(&mlfqs_dirty_list);
+	load_avg = 0;
+
 	/* Set up a thread structure for the running thread. */
 	initial_thread = running_thread();
 	init_thread(initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid();
+	cpus[0].curr = initial_thread;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -178,6 +255,10 @@ void thread_start(void)
 	struct semaphore idle_started;
 	sema_init(&idle_started, 0);
 
+	/* Only the boot CPU runs threads, so split its ready threads
+		 over scheduling domains. */
+	rq_cnt = RQ_DOMAINS;
+
 	// idle 스레드를 만들고 맨 처음 ready queue에 들어간다.
 	// semaphore를 1로 UP 시켜 공유 자원의 접근을 가능하게 한 다음 바로 BLOCK된다.
 	thread_create("idle", PRI_MIN, idle, &idle_started);
@@ -200,6 +281,9 @@ void thread_tick(void)
 	struct thread *t = thread_current();
 
 	/* Update statistics. */
+	t->stats.run_ticks++;
+	if (t != idle_thread)
+		run_queues[t->rq].busy_ticks++;
 	if (t == idle_thread)
 		idle_ticks++;
 #ifdef USERPROG
@@ -209,6 +293,10 @@ void thread_tick(void)
 	else
 		kernel_ticks++;
 
+	/* Even out the run queues now and then. */
+	if (rq_cnt > 1 && timer_ticks() % RQ_BALANCE_TICKS == 0)
+		rq_balance();
+
 	/* Enforce preemption. */
 	if (++thread_ticks >= TIME_SLICE)
 		intr_yield_on_return();
@@ -219,6 +307,70 @@ void thread_print_stats(void)
 {
 	printf("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
 				 idle_ticks, kernel_ticks, user_ticks);
+	for (int rq = 0; rq < rq_cnt; rq++)
+		printf("Run queue %d: %lld busy ticks, %lld steals\n",
+					 rq, run_queues[rq].busy_ticks, run_queues[rq].steal_cnt);
+}
+
+/* Returns the number of run queues in use. */
+int thread_rq_count(void)
+{
+	return rq_cnt;
+}
+
+/* Returns the number of timer ticks that threads of run queue RQ
+	 have run so far. */
+int64_t thread_rq_busy_ticks(int rq)
+{
+	ASSERT(0 <= rq && rq < rq_cnt);
+	return run_queues[rq].busy_ticks;
+}
+
+/* Fills BUFFER, which is SIZE bytes of kernel memory, with a
+	 snapshot of every thread's scheduling statistics in the format
+	 described in lib/thread-stats.h.  Threads that do not fit are
+	 left out, but still counted in the header's thread_cnt.
+	 Returns the number of records written, or -1 if SIZE is too
+	 small even for the header. */
+int thread_stats_snapshot(void *buffer, size_t size)
+{
+	struct thread_stats_header *h = buffer;
+	struct thread_stats_record *r = (struct thread_stats_record *)(h + 1);
+	size_t max_cnt;
+	enum intr_level old_level;
+	struct list_elem *e;
+
+	if (size < sizeof *h)
+		return -1;
+	max_cnt = (size - sizeof *h) / sizeof *r;
+
+	h->magic = THREAD_STATS_MAGIC;
+	h->record_size = sizeof *r;
+	h->record_cnt = 0;
+	h->thread_cnt = 0;
+
+	/* Statistics change in the timer interrupt, so take them all at once. */
+	old_level = intr_disable();
+	h->ticks = timer_ticks();
+	for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+	{
+		struct thread *t = list_entry(e, struct thread, all_elem);
+
+		h->thread_cnt++;
+		if (h->record_cnt >= max_cnt)
+			continue;
+		r->tid = t->tid;
+		r->status = t->status;
+		r->priority = t->priority;
+		r->nice = t->nice;
+		strlcpy(r->name, t->name, sizeof r->name);
+		r->stats = t->stats;
+		r++;
+		h->record_cnt++;
+	}
+	intr_set_level(old_level);
+
+	return h->record_cnt;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -266,6 +418,18 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	init_thread(t, name, priority);
 	struct thread *parent = thread_current();
 
+	/* Start out on the run queue with the least work. */
+	t->rq = rq_least_loaded();
+
+	/* Under MLFQS the child inherits its parent's nice and
+		 recent_cpu, and PRIORITY is ignored. */
+	if (thread_mlfqs)
+	{
+		t->nice = parent->nice;
+		t->recent_cpu = parent->recent_cpu;
+		t->priority = mlfqs_priority(t);
+	}
+
 	// 프로세스 계층구조 구현
 	list_push_back(&parent->child_list, &t->child_elem);
 
@@ -274,6 +438,12 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	t->fd_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES); // 해당 프로세스의 FDT 공간 할당
 	if (t->fd_table == NULL)
 	{ // 제대로 공간이 할당되지 않았다면 에러.
+		/* init_thread() already put T on all_list. */
+		enum intr_level old_level = intr_disable();
+		list_remove(&t->all_elem);
+		intr_set_level(old_level);
+		list_remove(&t->child_elem);
+		palloc_free_page(t);
 		return TID_ERROR;
 	}
 	tid = t->tid = allocate_tid();
@@ -302,8 +472,8 @@ tid_t thread_create(const char *name, int priority, thread_func *function, void
 	// 현재 실행중인 thread와 우선순위를 비교하여, 새로 생성된 thread의 우선순위가 높다면
 	if (preempt_by_priority())
 	{
-		// thread_yield()를 통해 CPU를 양보.
-		thread_yield();
+		// thread_preempt()를 통해 CPU를 양보.
+		thread_preempt();
 	}
 	// printf("tid1??????????????????????! : %d\n", thread_current()->tid); // 3
 	return tid;
@@ -326,6 +496,7 @@ void thread_block(void)
 	ASSERT(!intr_context());
 	ASSERT(intr_get_level() == INTR_OFF);
 	thread_current()->status = THREAD_BLOCKED;
+	thread_current()->stats.voluntary_switches++;
 	schedule();
 }
 
@@ -340,18 +511,16 @@ void thread_block(void)
 void thread_unblock(struct thread *t)
 {
 	enum intr_level old_level;
-	struct list_elem *e;
 
 	ASSERT(is_thread(t));
 
 	old_level = intr_disable();
 	ASSERT(t->status == THREAD_BLOCKED);
-	// 맨뒤로 넣지않고
-	// list_push_back (&ready_list, &t->elem);
 	// (Priority Scheduling - thread_unblock)
-	// 선형팀색으로 적절한 자리 찾아서 들어가기(우선순위 낮은애를 뒤로)
-	list_insert_ordered(&ready_list, &t->elem, &cmp_priority, NULL);
+	// 자기 우선순위 큐의 맨 뒤에 넣는다. 같은 우선순위끼리는 FIFO.
+	ready_queue_push(t);
 	t->status = THREAD_READY;
+	t->ready_since = timer_ticks();
 	intr_set_level(old_level);
 }
 
@@ -405,16 +574,21 @@ void thread_exit(void)
 #ifdef USERPROG
 	process_exit();
 #endif
+	malloc_thread_exit();
 
 	/* Just set our status to dying and schedule another process.
 		 We will be destroyed during the call to schedule_tail(). */
 	intr_disable();
+	list_remove(&thread_current()->all_elem);
+	if (thread_current()->mlfqs_dirty)
+		list_remove(&thread_current()->dirty_elem);
 	do_schedule(THREAD_DYING);
 	NOT_REACHED();
 }
 
 /* Yields the CPU.  The current thread is not put to sleep and
-	 may be scheduled again immediately at the scheduler's whim. */
+	 may be scheduled again immediately at the scheduler's whim.
+	 The switch counts as voluntary. */
 // CPU를 양보하고, thread를 ready_list에 삽입(Alarm Clock)
 void thread_yield(void)
 {
@@ -425,11 +599,27 @@ void thread_yield(void)
 	ASSERT(!intr_context());
 
 	old_level = intr_disable();		// 인터럽트를 disable한다.
+	curr->yielding = true;
+	thread_preempt();
+	intr_set_level(old_level);
+}
+
+/* Like thread_yield(), but on behalf of the scheduler: the time
+	 slice ran out or a higher priority thread became ready.  The
+	 switch counts as involuntary. */
+void thread_preempt(void)
+{
+	struct thread *curr = thread_current();
+	enum intr_level old_level;
+
+	ASSERT(!intr_context());
+
+	old_level = intr_disable();
 
 	// 만약 현재 스레드가 idle 스레드가 아니라면 ready queue에 다시 담는다.
 	// idle 스레드라면 담지 않는다. 어차피 static으로 선언되어 있어, 필요할 때 불러올 수 있다.
 	if (curr != idle_thread) {
-		list_push_back(&ready_list, &curr->elem);
+		ready_queue_push(curr);
 	}
 
 	do_schedule(THREAD_READY);
@@ -439,13 +629,17 @@ void thread_yield(void)
 /* Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority)
 {
+	/* The MLFQS scheduler computes priorities itself. */
+	if (thread_mlfqs)
+		return;
+
 	thread_current()->initial_priority = new_priority;
 
 	/* --------- project1 ---------- */
 	refresh_priority();
 	if (preempt_by_priority())
 	{
-		thread_yield();
+		thread_preempt();
 	}
 	/* ----------------------------- */
 }
@@ -456,31 +650,47 @@ int thread_get_priority(void)
 	return thread_current()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
-void thread_set_nice(int nice UNUSED)
+/* Sets the current thread's nice value to NICE and recomputes
+	 its priority, yielding if it no longer has the highest. */
+void thread_set_nice(int nice)
 {
-	/* TODO: Your implementation goes here */
+	struct thread *curr = thread_current();
+	enum intr_level old_level;
+
+	ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+
+	old_level = intr_disable();
+	curr->nice = nice;
+	if (thread_mlfqs && curr != idle_thread)
+		thread_change_priority(curr, mlfqs_priority(curr));
+	intr_set_level(old_level);
+
+	if (preempt_by_priority())
+		thread_preempt();
 }
 
 /* Returns the current thread's nice value. */
 int thread_get_nice(void)
 {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int thread_get_load_avg(void)
 {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable();
+	int load_avg_100 = fp_to_int_round(mult_mixed(load_avg, 100));
+	intr_set_level(old_level);
+	return load_avg_100;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void)
 {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable();
+	int recent_cpu_100 = fp_to_int_round(mult_mixed(thread_current()->recent_cpu, 100));
+	intr_set_level(old_level);
+	return recent_cpu_100;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -507,6 +717,7 @@ idle(void *idle_started_ UNUSED)
 
 	// 현재 돌고 있는 스레드가 idle밖에 없다.
 	idle_thread = thread_current();
+	cpus[0].idle = idle_thread;
 	sema_up (idle_started);  // semaphore의 값을 1로 만들어 줘 공유 자원의 공유(인터럽트) 가능!
 
 	for (;;)
@@ -515,6 +726,10 @@ idle(void *idle_started_ UNUSED)
 		intr_disable();		// 자기 자신(idle)을 BLOCK해주기 전까지 인터럽트 당하면 안되므로 먼저 disable한다.
 		thread_block();		// 자기 자신을 BLOCK한다.
 
+		/* In tickless mode, sleep until the next wakeup instead of
+			 taking every timer tick. */
+		timer_idle_enter();
+
 		/* Re-enable interrupts and wait for the next one.
 
 			 The `sti' instruction disables interrupts until the
@@ -541,6 +756,26 @@ idle(void *idle_started_ UNUSED)
 	}
 }
 
+/* Sets up an idle thread named NAME for an application processor,
+	 which switches to its stack in ap_main().  It never runs on the
+	 BSP, so it is kept off all_list and out of the run queues.
+	 Returns a null pointer if no page is free. */
+struct thread *
+thread_alloc_idle(const char *name)
+{
+	struct thread *t = palloc_get_page(PAL_ZERO);
+	enum intr_level old_level;
+
+	if (t == NULL)
+		return NULL;
+	init_thread(t, name, PRI_MIN);
+	old_level = intr_disable();
+	list_remove(&t->all_elem);
+	intr_set_level(old_level);
+	t->tid = allocate_tid();
+	return t;
+}
+
 /* Function used as the basis for a kernel thread. */
 static void
 kernel_thread(thread_func *function, void *aux)
@@ -557,6 +792,8 @@ kernel_thread(thread_func *function, void *aux)
 static void
 init_thread(struct thread *t, const char *name, int priority)
 {
+	enum intr_level old_level;
+
 	ASSERT(t != NULL);
 	ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
 	ASSERT(name != NULL);
@@ -571,11 +808,22 @@ init_thread(struct thread *t, const char *name, int priority)
 	t->magic = THREAD_MAGIC;
 
 	/* -------- Project 1 ----------- */
-	list_init(&t->donation_list);
+	heap_init(&t->held_locks, held_lock_more, NULL);
+	heap_init(&t->rw_holds, rw_hold_more, NULL);
 	t->initial_priority = priority;
 	t->wait_on_lock = NULL;
+	t->wait_on_rw = NULL;
 	/* ------------------------------ */
 
+	/* -------- MLFQS ----------- */
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = 0;
+	t->mlfqs_dirty = false;
+	old_level = intr_disable();
+	list_push_back(&all_list, &t->all_elem);
+	intr_set_level(old_level);
+	/* -------------------------- */
+
 	/* -------- Project 2 ----------- */
 	t->exit_status = 0;
 	list_init(&t->child_list);
@@ -601,18 +849,13 @@ init_thread(struct thread *t, const char *name, int priority)
 static struct thread *
 next_thread_to_run(void)
 {
-	if (list_empty(&ready_list))
+	if (ready_cnt == 0)
 		return idle_thread;
-	else
-	{
-		/* ---------------- project 1 -----------------*/
-		list_sort(&ready_list, &cmp_priority, NULL);
-		/* --------------------------------------------*/
-		// 어떤 리스트의 원소가 담겨 있는 구조체의 시작 주소를 반환한다.
-		// list_pop_front (&ready_list) => ready_list에서 팝된항목의 주소를 가져옴
-		// list_entry => 쓰레드구조체에서 팝된 항목의 주소로 쓰레드 가져옴
-		return list_entry(list_pop_front(&ready_list), struct thread, elem);
-	}
+
+	/* ---------------- project 1 -----------------*/
+	// 가장 높은 우선순위 큐의 맨 앞 스레드를 꺼낸다.
+	return ready_queue_pop();
+	/* --------------------------------------------*/
 }
 
 /* Use iretq to launch the thread */
@@ -671,6 +914,8 @@ thread_launch(struct thread *th)
 	uint64_t tf = (uint64_t)&th->tf;
 	ASSERT(intr_get_level() == INTR_OFF);
 
+	trace(TRACE_LAUNCH, TRACE_MARK, th->tid);
+
 	/* The main switching logic.
 	 * We first restore the whole execution context into the intr_frame
 	 * and then switching to the next thread by calling do_iret.
@@ -777,9 +1022,38 @@ schedule(void)
 	// runnung할 쓰레드가 존재하면
 	ASSERT(is_thread(next));
 
+	/* Leaving the idle thread, whether it blocked itself or an
+		 interrupt woke another thread and yields to it: if it slept
+		 tickless, bring ticks up to date and restart the periodic
+		 tick before anything else runs. */
+	if (curr == idle_thread)
+		timer_idle_exit();
+
+	/* Update statistics.  Being switched out while still runnable
+		 means we were preempted, unless we yielded. */
+	if (curr != next)
+	{
+		int64_t now = timer_ticks();
+
+		if (curr->status == THREAD_READY)
+		{
+			if (curr->yielding)
+				curr->stats.voluntary_switches++;
+			else
+				curr->stats.involuntary_switches++;
+			curr->ready_since = now;
+		}
+		if (next->status == THREAD_READY)
+			next->stats.ready_ticks += now - next->ready_since;
+	}
+	curr->yielding = false;
+
+	trace(TRACE_SCHEDULE, TRACE_MARK, next->tid);
+
 	/* Mark us as running. */
 	// next를 실행상태로
 	next->status = THREAD_RUNNING;
+	cpu_current()->curr = next;
 
 	/* Start new time slice. */
 	thread_ticks = 0;
@@ -868,8 +1142,8 @@ void thread_sleep(int64_t ticks)
 		next_tick_to_awake = ticks;
 	}
 	curr->wake_up_tick = ticks;
-	// 슬립 큐에 삽입하고
-	list_push_back(&sleep_list, &curr->elem);
+	// 슬립 큐(min-heap)에 삽입하고
+	heap_push(&sleep_heap, &curr->sleep_elem);
 	// 현재 스레드를 슬립 큐에 삽입한 후에 !스케줄한다!
 	thread_block();
 	// 인터럽트 받읋수 있는 상태로 만들기
@@ -881,41 +1155,30 @@ void thread_sleep(int64_t ticks)
 void thread_awake(int64_t ticks)
 {
 	/*
-	sleep list의 모든 entry 를 순회하며 다음과 같은 작업을 수행한다.
-	현재 tick이 깨워야 할 tick 보다 크거나 같다면 슬립 큐에서 제거하고
-	unblock 한다. 작다면 update_next_tick_to_awake() 를 호출한다.
+	sleep heap의 top부터 현재 tick이 깨워야 할 tick 보다 크거나 같은 동안
+	heap에서 꺼내 unblock 한다. 남은 top의 tick이 다음에 깨울 tick이 된다.
+	깨울 스레드 k개에 대해 O(k log n).
 	*/
-
-	next_tick_to_awake = INT64_MAX;
-	enum intr_level old_level;
-	struct list_elem *e;
 	ASSERT(intr_context());
 
-	// sleep list의 모든 entry 를 순회하며 다음과 같은 작업을 수행한다.
-	for (e = list_begin(&sleep_list); e != list_end(&sleep_list);)
+	while (!heap_empty(&sleep_heap))
 	{
-		struct thread *t = list_entry(e, struct thread, elem);
-		// 현재 tick이 깨워야 할 tick 보다 크거나 같다면
-		if (t->wake_up_tick <= ticks)
-		{
-			// 슬립 큐에서 제거하고 unblock 한다.
-			e = list_remove(e);
-			thread_unblock(t);
-			if (preempt_by_priority())
-			{
-				intr_yield_on_return();
-			}
-		}
-		// 현재틱이 더 작음
-		else
+		struct thread *t = heap_entry(heap_top(&sleep_heap), struct thread, sleep_elem);
+		if (t->wake_up_tick > ticks)
+			break;
+
+		heap_pop(&sleep_heap);
+		thread_unblock(t);
+		if (preempt_by_priority())
 		{
-			if (t->wake_up_tick < next_tick_to_awake)
-			{
-				next_tick_to_awake = t->wake_up_tick;
-			}
-			e = list_next(e);
+			intr_yield_on_return();
 		}
 	}
+
+	if (heap_empty(&sleep_heap))
+		next_tick_to_awake = INT64_MAX;
+	else
+		next_tick_to_awake = heap_entry(heap_top(&sleep_heap), struct thread, sleep_elem)->wake_up_tick;
 }
 
 /* global function to get value of next_tick_to_awake */
@@ -930,20 +1193,302 @@ int64_t get_next_tick_to_awake(void)
 	if running thread priority < highest priority thread in ready_list , return true */
 bool preempt_by_priority(void)
 {
-	int curr_priority;
-	struct thread *max_ready_thread;
-	struct list_elem *max_ready_elem;
+	if (ready_cnt == 0)
+		return false; /* !! if ready list is empty, return false directly !!*/
 
-	curr_priority = thread_get_priority();
+	return thread_get_priority() < ready_queue_max_priority();
+}
 
-	if (list_empty(&ready_list))
-		return false; /* !! if ready list is empty, return false directly !!*/
+/* Sets T's effective priority to PRIORITY.  If T is sitting in the
+	 ready queue it is moved to the queue for its new priority, which
+	 keeps donation to a preempted lock holder O(1).  If T is waiting
+	 on a semaphore or condition variable, it is moved within that
+	 waiters heap instead. */
+void thread_change_priority(struct thread *t, int priority)
+{
+	enum intr_level old_level;
 
-	list_sort(&ready_list, &cmp_priority, NULL);
-	max_ready_elem = list_begin(&ready_list);
-	max_ready_thread = list_entry(max_ready_elem, struct thread, elem);
+	ASSERT(is_thread(t));
+	ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
 
-	return curr_priority < max_ready_thread->priority;
+	old_level = intr_disable();
+	if (t->priority != priority)
+	{
+		if (t->status == THREAD_READY)
+		{
+			ready_queue_remove(t);
+			t->priority = priority;
+			ready_queue_push(t);
+		}
+		else
+			t->priority = priority;
+
+		/* A READY thread may still be on a waiter heap: cond_wait()
+			 and lock_acquire() push it there before sema_down(), and it
+			 can be preempted in between. */
+		sema_waiter_update(t);
+	}
+	intr_set_level(old_level);
+}
+
+/* Stamps T, which has just become ready, with the next sequence
+	 number and appends it to the list for its priority in its home
+	 run queue. */
+static void
+ready_queue_push(struct thread *t)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+	t->ready_seq = ready_seq++;
+	ready_queue_insert(t);
+}
+
+/* Adds T to the list for its priority in its home run queue, in
+	 the order of the sequence number it already has.  That is at the
+	 tail unless T was moved over from another run queue. */
+static void
+ready_queue_insert(struct thread *t)
+{
+	struct run_queue *rq = &run_queues[t->rq];
+	int idx = t->priority - PRI_MIN;
+	struct list_elem *e = list_end(&rq->queues[idx]);
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	while (e != list_begin(&rq->queues[idx])
+				 && list_entry(list_prev(e), struct thread, elem)->ready_seq > t->ready_seq)
+		e = list_prev(e);
+	list_insert(e, &t->elem);
+	rq->bitmap |= 1ULL << idx;
+	rq->cnt++;
+	ready_cnt++;
+}
+
+/* Removes T from its run queue. */
+static void
+ready_queue_remove(struct thread *t)
+{
+	struct run_queue *rq = &run_queues[t->rq];
+	int idx = t->priority - PRI_MIN;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+	list_remove(&t->elem);
+	if (list_empty(&rq->queues[idx]))
+		rq->bitmap &= ~(1ULL << idx);
+	rq->cnt--;
+	ready_cnt--;
+}
+
+/* Returns the highest priority that has a ready thread in any run
+	 queue.  There must be a ready thread. */
+static int
+ready_queue_max_priority(void)
+{
+	uint64_t bitmap = 0;
+
+	for (int rq = 0; rq < rq_cnt; rq++)
+		bitmap |= run_queues[rq].bitmap;
+	ASSERT(bitmap != 0);
+	return PRI_MIN + 63 - __builtin_clzll(bitmap);
+}
+
+/* Removes and returns the thread to run next: of the threads at
+	 the highest priority level, the one that became ready first,
+	 whichever run queue it is on.  If that leaves its run queue
+	 empty, the queue steals from its busiest peer.  There must be a
+	 ready thread. */
+static struct thread *
+ready_queue_pop(void)
+{
+	struct thread *t = NULL;
+	int idx;
+
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	idx = ready_queue_max_priority() - PRI_MIN;
+	for (int rq = 0; rq < rq_cnt; rq++)
+		if (run_queues[rq].bitmap & (1ULL << idx))
+		{
+			struct thread *head = list_entry(list_front(&run_queues[rq].queues[idx]),
+																			 struct thread, elem);
+			if (t == NULL || head->ready_seq < t->ready_seq)
+				t = head;
+		}
+	ASSERT(t != NULL);
+
+	ready_queue_remove(t);
+	if (run_queues[t->rq].cnt == 0)
+		rq_steal(t->rq);
+	return t;
+}
+
+/* Returns the load of run queue RQ: its ready threads, plus the
+	 running thread if RQ is its home. */
+static int
+rq_load(int rq)
+{
+	struct thread *curr = running_thread();
+	int load = run_queues[rq].cnt;
+
+	if (curr != idle_thread && curr->status == THREAD_RUNNING && curr->rq == rq)
+		load++;
+	return load;
+}
+
+/* Returns the run queue with the lowest load. */
+static int
+rq_least_loaded(void)
+{
+	int best = 0;
+
+	for (int rq = 1; rq < rq_cnt; rq++)
+		if (rq_load(rq) < rq_load(best))
+			best = rq;
+	return best;
+}
+
+/* Moves one ready thread from run queue SRC to DST: the newest
+	 thread at SRC's highest priority level, which is the one that
+	 would otherwise wait longest there. */
+static void
+rq_migrate(int src, int dst)
+{
+	struct run_queue *from = &run_queues[src];
+	int idx = 63 - __builtin_clzll(from->bitmap);
+	struct thread *t = list_entry(list_back(&from->queues[idx]),
+																struct thread, elem);
+
+	ASSERT(from->cnt > 0);
+	ready_queue_remove(t);
+	t->rq = dst;
+	ready_queue_insert(t);
+	run_queues[dst].steal_cnt++;
+}
+
+/* Run queue DST is empty: steals a thread from the peer with the
+	 most ready threads, if that peer has more than one. */
+static void
+rq_steal(int dst)
+{
+	int busiest = -1;
+
+	for (int rq = 0; rq < rq_cnt; rq++)
+		if (rq != dst && run_queues[rq].cnt > 1
+				&& (busiest < 0 || run_queues[rq].cnt > run_queues[busiest].cnt))
+			busiest = rq;
+	if (busiest >= 0)
+		rq_migrate(busiest, dst);
+}
+
+/* Moves ready threads from the most to the least loaded run queue
+	 until their loads differ by at most one. */
+static void
+rq_balance(void)
+{
+	ASSERT(intr_get_level() == INTR_OFF);
+
+	for (;;)
+	{
+		int busiest = 0, idlest = 0;
+
+		for (int rq = 1; rq < rq_cnt; rq++)
+		{
+			if (rq_load(rq) > rq_load(busiest))
+				busiest = rq;
+			if (rq_load(rq) < rq_load(idlest))
+				idlest = rq;
+		}
+		if (rq_load(busiest) - rq_load(idlest) <= 1 || run_queues[busiest].cnt == 0)
+			break;
+		rq_migrate(busiest, idlest);
+	}
+}
+
+/* ------------------------- MLFQS ------------------------- */
+
+/* Returns T's MLFQS priority,
+	 PRI_MAX - (recent_cpu / 4) - (nice * 2), clamped to
+	 PRI_MIN..PRI_MAX. */
+static int
+mlfqs_priority(struct thread *t)
+{
+	int priority = PRI_MAX - fp_to_int(div_mixed(t->recent_cpu, 4)) - t->nice * 2;
+
+	if (priority < PRI_MIN)
+		return PRI_MIN;
+	if (priority > PRI_MAX)
+		return PRI_MAX;
+	return priority;
+}
+
+/* Decays T's recent_cpu:
+	 (2 * load_avg) / (2 * load_avg + 1) * recent_cpu + nice. */
+static void
+mlfqs_update_recent_cpu(struct thread *t)
+{
+	fixed_t twice_load = mult_mixed(load_avg, 2);
+	fixed_t coeff = div_fp(twice_load, add_mixed(twice_load, 1));
+
+	t->recent_cpu = add_mixed(mult_fp(coeff, t->recent_cpu), t->nice);
+}
+
+/* MLFQS bookkeeping, called by the timer interrupt handler on
+	 every tick when thread_mlfqs is set.
+
+	 Each tick only the running thread's recent_cpu changes, so it
+	 alone is charged and remembered on mlfqs_dirty_list.  Every
+	 fourth tick only the threads on that list get a new priority.
+	 Once a second load_avg and every thread's recent_cpu decay,
+	 which is a single pass over all_list; a thread whose priority
+	 changes while ready is moved between ready queues in O(1). */
+void mlfqs_tick(int64_t ticks)
+{
+	struct thread *curr = thread_current();
+	struct list_elem *e;
+
+	ASSERT(intr_context());
+
+	if (curr != idle_thread)
+	{
+		curr->recent_cpu = add_mixed(curr->recent_cpu, 1);
+		if (!curr->mlfqs_dirty)
+		{
+			curr->mlfqs_dirty = true;
+			list_push_back(&mlfqs_dirty_list, &curr->dirty_elem);
+		}
+	}
+
+	if (ticks % TIMER_FREQ == 0)
+	{
+		/* load_avg = (59/60) * load_avg + (1/60) * ready_threads. */
+		int ready_threads = ready_cnt + (curr != idle_thread ? 1 : 0);
+		load_avg = add_fp(mult_fp(div_mixed(int_to_fp(59), 60), load_avg),
+											mult_mixed(div_mixed(int_to_fp(1), 60), ready_threads));
+
+		for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e))
+		{
+			struct thread *t = list_entry(e, struct thread, all_elem);
+			if (t == idle_thread)
+				continue;
+			mlfqs_update_recent_cpu(t);
+			if (!t->mlfqs_dirty)
+			{
+				t->mlfqs_dirty = true;
+				list_push_back(&mlfqs_dirty_list, &t->dirty_elem);
+			}
+		}
+	}
+
+	if (ticks % 4 == 0)
+	{
+		while (!list_empty(&mlfqs_dirty_list))
+		{
+			struct thread *t = list_entry(list_pop_front(&mlfqs_dirty_list),
+																		struct thread, dirty_elem);
+			t->mlfqs_dirty = false;
+			thread_change_priority(t, mlfqs_priority(t));
+		}
+		if (preempt_by_priority())
+			intr_yield_on_return();
+	}
 }
 
 /* compare threads' priority of element1 and element2 by **elem** in struct thread */
@@ -954,13 +1499,12 @@ bool cmp_priority(struct list_elem *element1, struct list_elem *element2, void *
 	return t1->priority > t2->priority;
 }
 
-/* compare threads' priority of element1 and element2 by **donation_elem** in struct thread */
-// 우선순위 순으로 들어감
-bool thread_donate_priority_compare(struct list_elem *element1, struct list_elem *element2, void *aux UNUSED)
+/* orders sleeping threads by **sleep_elem**, earliest wake_up_tick first */
+static bool
+wake_up_tick_less(const struct heap_elem *a, const struct heap_elem *b, void *aux UNUSED)
 {
-	struct thread *t1 = list_entry(element1, struct thread, donation_elem);
-	struct thread *t2 = list_entry(element2, struct thread, donation_elem);
-	return t1->priority > t2->priority;
+	return heap_entry(a, struct thread, sleep_elem)->wake_up_tick
+			 < heap_entry(b, struct thread, sleep_elem)->wake_up_tick;
 }
 
 /* ------------------- project 1 functions end ------------------------------- */
@@ -0,0 +1,152 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <stdio.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#ifdef FILESYS
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#endif
+
+/* Size of the ring buffer, in pages. */
+#define TRACE_PAGES 64
+
+/* -trace: Record trace events? */
+bool trace_enabled;
+
+static struct trace_event *trace_buf;   /* Ring buffer. */
+static size_t trace_cnt;                /* Capacity of trace_buf, in events. */
+static uint64_t trace_head;             /* Events ever recorded. */
+
+/* Time stamp counter and timer ticks when tracing started, to
+   work out the time stamp counter frequency. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+static void trace_fill_header (struct trace_header *);
+
+/* Allocates the ring buffer if tracing was requested on the
+   command line.  Must be called after palloc_init(). */
+void
+trace_init (void) {
+	if (!trace_enabled)
+		return;
+
+	trace_buf = palloc_get_multiple (PAL_ZERO, TRACE_PAGES);
+	if (trace_buf == NULL) {
+		printf ("trace: could not allocate buffer, tracing disabled\n");
+		trace_enabled = false;
+		return;
+	}
+	trace_cnt = TRACE_PAGES * PGSIZE / sizeof *trace_buf;
+	start_tsc = rdtsc ();
+	start_ticks = timer_ticks ();
+}
+
+/* Appends an event to the ring buffer.  Use trace() instead,
+   which skips the call when tracing is off. */
+void
+trace_record (enum trace_type type, enum trace_phase phase, uint64_t arg) {
+	struct thread *t = (struct thread *) pg_round_down (rrsp ());
+	enum intr_level old_level;
+	struct trace_event *e;
+
+	if (trace_buf == NULL)
+		return;
+
+	old_level = intr_disable ();
+	e = &trace_buf[trace_head++ % trace_cnt];
+	e->tsc = rdtsc ();
+	e->arg = arg;
+	e->tid = t->tid;
+	e->type = type;
+	e->phase = phase;
+	intr_set_level (old_level);
+}
+
+/* Fills in H for the events currently in the buffer. */
+static void
+trace_fill_header (struct trace_header *h) {
+	int64_t ticks = timer_ticks () - start_ticks;
+
+	h->magic = TRACE_MAGIC;
+	h->event_size = sizeof (struct trace_event);
+	h->event_cnt = trace_head < trace_cnt ? trace_head : trace_cnt;
+	h->dropped_cnt = trace_head - h->event_cnt;
+	h->tsc_hz = ticks > 0 ? (rdtsc () - start_tsc) * TIMER_FREQ / ticks : 0;
+}
+
+/* Returns the Ith oldest event in the buffer. */
+static struct trace_event *
+trace_event_at (uint64_t i, const struct trace_header *h) {
+	return &trace_buf[(h->dropped_cnt + i) % trace_cnt];
+}
+
+/* Prints the buffer to the console, one event per line, oldest
+   first.  Tracing is paused while we print, so that the dump does
+   not trace itself. */
+void
+trace_dump (char **argv UNUSED) {
+	struct trace_header h;
+	uint64_t i;
+
+	if (trace_buf == NULL) {
+		printf ("trace: tracing is off (use -trace)\n");
+		return;
+	}
+
+	trace_enabled = false;
+	trace_fill_header (&h);
+	printf ("trace: begin %llu %llu %llu\n",
+			h.event_cnt, h.dropped_cnt, h.tsc_hz);
+	for (i = 0; i < h.event_cnt; i++) {
+		struct trace_event *e = trace_event_at (i, &h);
+		printf ("trace: %llu %d %u %u %#llx\n",
+				e->tsc, e->tid, e->type, e->phase, e->arg);
+	}
+	printf ("trace: end\n");
+	trace_enabled = true;
+}
+
+#ifdef FILESYS
+/* Saves the buffer into file ARGV[1] as a struct trace_header
+   followed by the events, oldest first.  Fetch it with
+   `pintos -g'. */
+void
+trace_save (char **argv) {
+	const char *file_name = argv[1];
+	struct trace_header h;
+	struct file *file;
+	uint64_t first;
+	off_t size;
+
+	if (trace_buf == NULL)
+		PANIC ("%s: tracing is off (use -trace)", file_name);
+
+	trace_enabled = false;
+	trace_fill_header (&h);
+	size = sizeof h + h.event_cnt * sizeof *trace_buf;
+	printf ("Saving %llu trace events to '%s'...\n", h.event_cnt, file_name);
+	if (!filesys_create (file_name, size))
+		PANIC ("%s: create failed", file_name);
+	file = filesys_open (file_name);
+	if (file == NULL)
+		PANIC ("%s: open failed", file_name);
+
+	/* The oldest events sit right after the newest ones. */
+	first = h.dropped_cnt % trace_cnt;
+	if (file_write (file, &h, sizeof h) != sizeof h
+			|| file_write (file, trace_buf + first,
+				(h.event_cnt - first) * sizeof *trace_buf)
+			!= (off_t) ((h.event_cnt - first) * sizeof *trace_buf)
+			|| file_write (file, trace_buf, first * sizeof *trace_buf)
+			!= (off_t) (first * sizeof *trace_buf))
+		PANIC ("%s: write failed", file_name);
+	file_close (file);
+	trace_enabled = true;
+}
+#endif
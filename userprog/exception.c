@@ -4,6 +4,7 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
@@ -129,6 +130,7 @@ page_fault (struct intr_frame *f) {
 	   that caused the fault (that's f->rip). */
 
 	fault_addr = (void *) rcr2();
+	trace (TRACE_PAGE_FAULT, TRACE_MARK, (uint64_t) fault_addr);
 
 	/* Turn interrupts back on (they were only off so that we could
 	   be assured of reading CR2 before it changed). */
@@ -142,7 +144,9 @@ page_fault (struct intr_frame *f) {
 	// Stack pointer(%esp)가 가리키는 주소에서 Page fault가 발생할 경우,
 	// exit(-1) 시스템 콜을 호출 하도록 수정
 	// Page fault의 관한 자세한 내용은 project 3에서 다룬다.
+#ifndef VM
 	exit(-1);
+#endif
 #ifdef VM
 	/* For project 3 and later. */
 	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
@@ -105,6 +105,13 @@ gdt_init (void) {
 		.res2 = 0
 	};
 
+	gdt_load ();
+}
+
+/* Loads the GDT and reloads the segment registers from it.  Called
+   by gdt_init() and by each application processor. */
+void
+gdt_load (void) {
 	lgdt (&gdt_ds);
 	/* reload segment registers */
 	asm volatile("movw %%ax, %%gs" :: "a" (SEL_UDSEG));
@@ -19,6 +19,8 @@
 #include "threads/vaddr.h"
 #include "intrinsic.h"
 #ifdef VM
+#include "threads/malloc.h"
+#include "userprog/syscall.h"
 #include "vm/vm.h"
 #endif
 
@@ -198,8 +200,8 @@ __do_fork (void *aux) {
 
 	process_activate (child);
 #ifdef VM
-	supplemental_page_table_init (&current->spt);
-	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
+	supplemental_page_table_init (&child->spt);
+	if (!supplemental_page_table_copy (&child->spt, &parent->spt))
 		goto error;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
@@ -277,6 +279,10 @@ process_exec (void *f_name) {
 
 	/* We first kill the current context */
 	process_cleanup ();  // 현재 프로세스가 사용하고 있던 pml4를 모두 반환한다.
+#ifdef VM
+	// process_cleanup()이 SPT를 없앴으므로 새로 만든다.
+	supplemental_page_table_init (&thread_current ()->spt);
+#endif
 
 	/* And then load the binary */
 	// printf("load_file_name: %s\n", file_name);  // => load_file_name: args-single onearg
@@ -812,9 +818,24 @@ install_page (void *upage, void *kpage, bool writable) {
 
 static bool
 lazy_load_segment (struct page *page, void *aux) {
-	/* TODO: Load the segment from the file */
-	/* TODO: This called when the first page fault occurs on address VA. */
-	/* TODO: VA is available when calling this function. */
+	struct file_segment *seg = aux;
+	uint8_t *kva = page->frame->kva;
+	bool locked = lock_held_by_current_thread (&filesys_lock);
+	bool success;
+
+	/* The fault may come from read() copying into this page, which
+	 * already holds filesys_lock. */
+	if (!locked)
+		lock_acquire (&filesys_lock);
+	success = file_read_at (seg->file, kva, seg->read_bytes, seg->ofs)
+		== (off_t) seg->read_bytes;
+	if (!locked)
+		lock_release (&filesys_lock);
+
+	if (success)
+		memset (kva + seg->read_bytes, 0, seg->zero_bytes);
+	file_segment_free (seg);
+	return success;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -845,16 +866,31 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
+		/* Each page gets its own handle on FILE, so that it does not
+		 * depend on how long FILE stays open. */
+		struct file_segment *aux = malloc (sizeof *aux);
+		if (aux == NULL)
+			return false;
+		aux->file = file_reopen (file);
+		aux->ofs = ofs;
+		aux->read_bytes = page_read_bytes;
+		aux->zero_bytes = page_zero_bytes;
+		aux->mapping = NULL;
+		if (aux->file == NULL) {
+			free (aux);
+			return false;
+		}
 		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
+					writable, lazy_load_segment, aux)) {
+			file_segment_free (aux);
 			return false;
+		}
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
 		upage += PGSIZE;
+		ofs += page_read_bytes;
 	}
 	return true;
 }
@@ -865,11 +901,11 @@ setup_stack (struct intr_frame *if_) {
 	bool success = false;
 	void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
 
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
-
+	if (vm_alloc_page (VM_ANON | VM_STACK, stack_bottom, true)
+			&& vm_claim_page (stack_bottom)) {
+		if_->rsp = USER_STACK;
+		success = true;
+	}
 	return success;
 }
 #endif /* VM */
@@ -14,12 +14,17 @@
 #include "kernel/stdio.h"
 #include "threads/palloc.h"
 /* ------------------------------- */
+#include "threads/trace.h"
+#include <round.h>
+#include <string.h>
+#include "threads/vaddr.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 
 /* ---------- Project 2 ---------- */
 void check_address(const uint64_t *uaddr);
+static void check_writable_buffer(void *buffer, size_t size);
 
 void halt (void);			/* 구현 완료 */
 void exit (int status);		/* 구현 완료 */
@@ -36,6 +41,12 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 /* ------------------------------- */
+int thread_stats (void *buffer, unsigned size);
+void yield (void);
+#ifdef VM
+void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
+void munmap (void *addr);
+#endif
 
 /* System call.
  *
@@ -50,6 +61,7 @@ void close (int fd);
 #define MSR_LSTAR 0xc0000082        /* Long mode SYSCALL target */
 #define MSR_SYSCALL_MASK 0xc0000084 /* Mask for the eflags */
 /* ---------- Project 2 ---------- */
+struct lock filesys_lock;
 const int STDIN = 0;
 const int STDOUT = 1;
 /* ------------------------------- */
@@ -86,6 +98,14 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	// 6번째 인자: %r9
 
 
+	uint64_t syscall_nr = f->R.rax;
+
+	trace (TRACE_SYSCALL, TRACE_BEGIN, syscall_nr);
+#ifdef VM
+	// 시스템 콜 도중의 페이지 폴트에서 스택 확장 여부를 판단하기 위해 유저 rsp를 저장
+	thread_current ()->user_rsp = (void *) f->rsp;
+#endif
+
 	/* ---------- Project 2 ---------- */
 	switch(f->R.rax) {
 		case SYS_HALT:
@@ -131,17 +151,41 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_CLOSE:
 			close(f->R.rdi);
 			break;
+		case SYS_THREAD_STATS:
+			f->R.rax = thread_stats((void *) f->R.rdi, f->R.rsi);
+			break;
+		case SYS_YIELD:
+			yield();
+			break;
+#ifdef VM
+		case SYS_MMAP:
+			f->R.rax = (uint64_t) mmap((void *) f->R.rdi, f->R.rsi, f->R.rdx,
+					f->R.r10, f->R.r8);
+			break;
+		case SYS_MUNMAP:
+			munmap((void *) f->R.rdi);
+			break;
+#endif
 		default:
 			exit(-1);
 			break;
 	}
 	/* ------------------------------- */
+
+	trace (TRACE_SYSCALL, TRACE_END, syscall_nr);
 }
 
 /* ---------- Project 2 ---------- */
 // 주소 값이 유저 영역 주소 값인지 확인 => 유저 영역을 벗어난 영역일 경우 프로세스 종료(exit(-1))
 void check_address (const uint64_t *user_addr) {
 	struct thread *curr = thread_current();
+#ifdef VM
+	// 지연 로딩되는 페이지는 아직 매핑되지 않았을 수 있으므로 SPT와 스택 영역을 본다.
+	if (user_addr == NULL || !is_user_vaddr(user_addr)
+			|| (spt_find_page(&curr->spt, (void *) user_addr) == NULL
+				&& !vm_is_stack_access(user_addr, curr->user_rsp)))
+		exit(-1);
+#else
 	// is_user_vaddr =>Returns true if VADDR is a user virtual address.
 	// 유저 가상 메모리의 영역은 가상 주소 0부터 KERN_BASE까지이다.
 	if (user_addr = NULL || !(is_user_vaddr(user_addr))|| // 'KERN_BASE'보다 높은 값의 주소값을 가지는 경우 or 주소가 NULL인경우
@@ -149,6 +193,26 @@ void check_address (const uint64_t *user_addr) {
 	{
 		exit(-1);
 	}
+#endif
+}
+
+// BUFFER부터 SIZE 바이트의 모든 페이지가 커널이 쓸 수 있는 유저 영역인지 확인 => 아니면 프로세스 종료(exit(-1))
+// 첫 바이트와 마지막 바이트만 보면 중간의 잘못된 페이지에서 복사 도중 페이지 폴트가 난다.
+static void check_writable_buffer (void *buffer, size_t size) {
+	uint8_t *start = buffer;
+	uint8_t *end = start + size;
+	uint8_t *p;
+
+	if (end < start)
+		exit(-1);
+	for (p = start; p < end; p = pg_round_down(p) + PGSIZE) {
+		check_address((const uint64_t *) p);
+#ifdef VM
+		struct page *page = spt_find_page(&thread_current()->spt, p);
+		if (page != NULL && !page->writable)
+			exit(-1);
+#endif
+	}
 }
 
 
@@ -205,6 +269,9 @@ void exit(int status) {
 	// 실행중인 스레드 구조체를 가져옴
 	struct thread *curr = thread_current();
 	curr->exit_status = status;
+	// read() 도중 유저 버퍼에 쓰다가 페이지 폴트로 종료될 수 있으므로 잡고 있던 filesys_lock을 놓는다.
+	if (lock_held_by_current_thread(&filesys_lock))
+		lock_release(&filesys_lock);
 	// 프로세스 종료 메시지 출력
 	// 출력 양식: "프로세스이름: exit(종료상태)"
 	printf("%s: exit(%d)\n", thread_name(), status);
@@ -437,4 +504,67 @@ void close (int fd) {
 	// file_close(file_obj);
 }
 
-/* ------------------------------- */
\ No newline at end of file
+/* ------------------------------- */
+
+/* Largest snapshot thread_stats() hands out, in pages. */
+#define THREAD_STATS_MAX_PAGES 4
+
+// 15. 스레드별 스케줄링 통계 스냅샷을 BUFFER에 채우는 시스템 콜. 기록한 스레드 수를 반환한다.
+// 스냅샷은 인터럽트를 끈 채로 커널 버퍼에 만든 뒤 유저 버퍼로 복사한다.
+int thread_stats (void *buffer, unsigned size) {
+	size_t page_cnt;
+	void *kbuf;
+	int record_cnt;
+
+	if (size == 0)
+		return -1;
+
+	page_cnt = DIV_ROUND_UP(size, PGSIZE);
+	if (page_cnt > THREAD_STATS_MAX_PAGES) {
+		page_cnt = THREAD_STATS_MAX_PAGES;
+		size = page_cnt * PGSIZE;
+	}
+	// 복사 도중 폴트로 종료되면 kbuf가 새므로, 할당 전에 기록할 범위 전체를 확인한다.
+	check_writable_buffer(buffer, size);
+	kbuf = palloc_get_multiple(0, page_cnt);
+	if (kbuf == NULL)
+		return -1;
+
+	record_cnt = thread_stats_snapshot(kbuf, size);
+	if (record_cnt >= 0)
+		memcpy(buffer, kbuf, sizeof (struct thread_stats_header)
+				+ record_cnt * sizeof (struct thread_stats_record));
+	palloc_free_multiple(kbuf, page_cnt);
+	return record_cnt;
+}
+
+// 16. CPU를 양보하는 시스템 콜. 같은 우선순위의 다른 스레드가 있으면 그쪽으로 전환된다.
+void yield (void) {
+	thread_yield();
+}
+
+#ifdef VM
+// 17. FD로 열린 파일의 OFFSET부터 LENGTH 바이트를 ADDR에 매핑하는 시스템 콜.
+// 페이지는 처음 접근할 때 읽어 온다. 성공하면 ADDR을, 실패하면 NULL을 반환한다.
+void *mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
+	struct file *file;
+
+	if (addr == NULL || pg_ofs(addr) != 0 || length == 0
+			|| offset < 0 || offset % PGSIZE != 0)
+		return NULL;
+	// 매핑 영역이 커널 영역에 걸치거나 주소가 한 바퀴 돌면 실패
+	if ((uintptr_t) addr + length < (uintptr_t) addr
+			|| !is_user_vaddr(addr) || !is_user_vaddr(addr + length - 1))
+		return NULL;
+	// 표준 입출력은 매핑할 수 없다.
+	if (fd < 2 || (file = get_file_from_fd_table(fd)) == NULL
+			|| file_length(file) == 0)
+		return NULL;
+	return do_mmap(addr, length, writable, file, offset);
+}
+
+// 18. mmap()이 돌려준 ADDR의 매핑을 해제하는 시스템 콜. 수정된 페이지는 파일에 다시 쓴다.
+void munmap (void *addr) {
+	do_munmap(addr);
+}
+#endif
@@ -1,7 +1,14 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <bitmap.h>
+#include <stdio.h>
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,11 +24,34 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* The swap disk is divided into page-sized slots. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+static struct bitmap *swap_slots;   /* Slots in use. */
+static uint16_t *swap_slot_refs;    /* Pages sharing each slot. */
+static size_t swap_slot_cnt;        /* Slots on the swap disk. */
+static struct lock swap_lock;       /* Protects swap_slots and refs. */
+
+/* Swap statistics.  Cycles are measured with the time stamp counter
+ * around the disk I/O. */
+static unsigned long long swap_out_cnt;     /* Pages written to swap. */
+static unsigned long long swap_kept_cnt;    /* Evicted without a write. */
+static unsigned long long swap_in_cnt;      /* Pages read from swap. */
+static unsigned long long swap_out_cycles;
+static unsigned long long swap_in_cycles;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	lock_init (&swap_lock);
+	swap_disk = disk_get (1, 1);
+	if (swap_disk == NULL)
+		return;
+	swap_slot_cnt = disk_size (swap_disk) / SECTORS_PER_SLOT;
+	swap_slots = bitmap_create (swap_slot_cnt);
+	swap_slot_refs = calloc (swap_slot_cnt, sizeof *swap_slot_refs);
+	if (swap_slots == NULL || swap_slot_refs == NULL)
+		PANIC ("swap: could not allocate slot table");
 }
 
 /* Initialize the file mapping */
@@ -31,22 +61,158 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->slot = SWAP_SLOT_NONE;
+	return true;
+}
+
+/* Allocates a swap slot for PAGE.  The search starts at a slot
+ * picked from PAGE's virtual page number, so that neighboring pages
+ * of a process tend to get neighboring slots and are read and
+ * written in order.  Returns SWAP_SLOT_NONE if swap is full. */
+static size_t
+swap_slot_alloc (struct page *page) {
+	size_t hint, slot;
+
+	if (swap_slots == NULL)
+		return SWAP_SLOT_NONE;
+
+	hint = (pg_no (page->va) + (size_t) page->owner->tid * 1021)
+		% swap_slot_cnt;
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip (swap_slots, hint, 1, false);
+	if (slot == BITMAP_ERROR)
+		slot = bitmap_scan_and_flip (swap_slots, 0, 1, false);
+	if (slot != BITMAP_ERROR)
+		swap_slot_refs[slot] = 1;
+	lock_release (&swap_lock);
+	return slot == BITMAP_ERROR ? SWAP_SLOT_NONE : slot;
+}
+
+/* Drops a reference to swap slot SLOT, and frees it if that was the
+ * last one. */
+static void
+swap_slot_put (size_t slot) {
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_slots, slot));
+	ASSERT (swap_slot_refs[slot] > 0);
+	if (--swap_slot_refs[slot] == 0)
+		bitmap_reset (swap_slots, slot);
+	lock_release (&swap_lock);
+}
+
+/* Returns true if other pages share swap slot SLOT. */
+static bool
+swap_slot_shared (size_t slot) {
+	bool shared;
+
+	lock_acquire (&swap_lock);
+	shared = swap_slot_refs[slot] > 1;
+	lock_release (&swap_lock);
+	return shared;
+}
+
+/* Makes DST, an anonymous page that is not in memory, share SRC's
+ * swap slot, which must hold the contents of both.  Used for pages
+ * that were shared copy-on-write when they were swapped out. */
+void
+anon_share_slot (struct page *dst, struct page *src) {
+	size_t slot = src->anon.slot;
+
+	ASSERT (slot != SWAP_SLOT_NONE);
+	if (dst->anon.slot != SWAP_SLOT_NONE)
+		swap_slot_put (dst->anon.slot);
+
+	lock_acquire (&swap_lock);
+	ASSERT (swap_slot_refs[slot] < UINT16_MAX);
+	swap_slot_refs[slot]++;
+	lock_release (&swap_lock);
+	dst->anon.slot = slot;
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	uint64_t start = rdtsc ();
+	disk_sector_t sector;
+	int i;
+
+	if (anon_page->slot == SWAP_SLOT_NONE)
+		return false;
+
+	/* Keep the slot: until the page is written to again, it still
+	 * holds the page's contents. */
+	sector = anon_page->slot * SECTORS_PER_SLOT;
+	for (i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_read (swap_disk, sector + i, kva + i * DISK_SECTOR_SIZE);
+
+	swap_in_cnt++;
+	swap_in_cycles += rdtsc () - start;
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.  A page
+ * that has not been written to since it was read from its slot is
+ * not written again.  One that has is written back to the same slot,
+ * unless other pages still share that slot. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	uint64_t start = rdtsc ();
+	void *kva = page->frame->kva;
+	disk_sector_t sector;
+	int i;
+
+	if (anon_page->slot != SWAP_SLOT_NONE) {
+		if (!pml4_is_dirty (page->owner->pml4, page->va)) {
+			swap_kept_cnt++;
+			return true;
+		}
+		if (swap_slot_shared (anon_page->slot)) {
+			swap_slot_put (anon_page->slot);
+			anon_page->slot = SWAP_SLOT_NONE;
+		}
+	}
+	if (anon_page->slot == SWAP_SLOT_NONE) {
+		anon_page->slot = swap_slot_alloc (page);
+		if (anon_page->slot == SWAP_SLOT_NONE)
+			return false;
+	}
+
+	sector = anon_page->slot * SECTORS_PER_SLOT;
+	for (i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_write (swap_disk, sector + i, kva + i * DISK_SECTOR_SIZE);
+	pml4_set_dirty (page->owner->pml4, page->va, false);
+
+	swap_out_cnt++;
+	swap_out_cycles += rdtsc () - start;
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	if (anon_page->slot != SWAP_SLOT_NONE) {
+		swap_slot_put (anon_page->slot);
+		anon_page->slot = SWAP_SLOT_NONE;
+	}
+}
+
+/* Prints swap statistics. */
+void
+anon_print_stats (void) {
+	if (swap_slots == NULL) {
+		printf ("Swap: no swap disk\n");
+		return;
+	}
+	printf ("Swap: %llu pages out (%llu evicted without a write), "
+			"%llu in, %zu of %zu slots in use\n",
+			swap_out_cnt, swap_kept_cnt, swap_in_cnt,
+			bitmap_count (swap_slots, 0, swap_slot_cnt, true), swap_slot_cnt);
+	if (swap_out_cnt + swap_in_cnt > 0)
+		printf ("Swap throughput: %llu cycles per page out, %llu per page in\n",
+				swap_out_cnt ? swap_out_cycles / swap_out_cnt : 0,
+				swap_in_cnt ? swap_in_cycles / swap_in_cnt : 0);
 }
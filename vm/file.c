@@ -1,5 +1,11 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
 #include "vm/vm.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
@@ -19,40 +25,212 @@ void
 vm_file_init (void) {
 }
 
+/* Returns a copy of SEG with its own handle on the file, or a null
+ * pointer if memory runs out. */
+struct file_segment *
+file_segment_dup (const struct file_segment *seg) {
+	struct file_segment *copy = malloc (sizeof *copy);
+
+	if (copy == NULL)
+		return NULL;
+	*copy = *seg;
+	copy->file = file_reopen (seg->file);
+	if (copy->file == NULL) {
+		free (copy);
+		return NULL;
+	}
+	return copy;
+}
+
+/* Closes SEG's file and frees SEG.  SEG may be a null pointer. */
+void
+file_segment_free (struct file_segment *seg) {
+	if (seg != NULL) {
+		file_close (seg->file);
+		free (seg);
+	}
+}
+
+/* Acquires filesys_lock, unless the current thread already holds
+ * it, as it does when read() faults on a mapped page.  Returns
+ * whether it did, to pass to fs_unlock(). */
+static bool
+fs_lock (void) {
+	if (lock_held_by_current_thread (&filesys_lock))
+		return false;
+	lock_acquire (&filesys_lock);
+	return true;
+}
+
+static void
+fs_unlock (bool locked) {
+	if (locked)
+		lock_release (&filesys_lock);
+}
+
 /* Initialize the file backed page */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &file_ops;
+	return true;
+}
 
+/* Loads PAGE, a page of an mmap()ed region, as described by AUX, a
+ * struct file_segment.  PAGE takes over AUX's file. */
+static bool
+file_map_load (struct page *page, void *aux) {
+	struct file_segment *seg = aux;
 	struct file_page *file_page = &page->file;
+
+	file_page->file = seg->file;
+	file_page->ofs = seg->ofs;
+	file_page->read_bytes = seg->read_bytes;
+	file_page->mapping = seg->mapping;
+	free (seg);
+	return file_backed_swap_in (page, page->frame->kva);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	bool locked = fs_lock ();
+	off_t read = file_read_at (file_page->file, kva, file_page->read_bytes,
+			file_page->ofs);
+
+	fs_unlock (locked);
+	memset ((uint8_t *) kva + file_page->read_bytes, 0,
+			PGSIZE - file_page->read_bytes);
+	return read == (off_t) file_page->read_bytes;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.
+ *
+ * The evictor calls this while the frame is busy, and holds
+ * filesys_lock if it picked the page dirty (see vm_evict_frames()).
+ * If the page was dirtied after it was picked as clean, the evictor
+ * may not hold the lock and must not wait for it, so the page stays
+ * in memory this time. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	uint64_t *pml4 = page->owner->pml4;
+
+	if (pml4_is_dirty (pml4, page->va)) {
+		if (!lock_held_by_current_thread (&filesys_lock))
+			return false;
+		if (file_write_at (file_page->file, page->frame->kva,
+					file_page->read_bytes, file_page->ofs)
+				!= (off_t) file_page->read_bytes)
+			return false;
+		pml4_set_dirty (pml4, page->va, false);
+	}
+	return true;
 }
 
-/* Destory the file backed page. PAGE will be freed by the caller. */
+/* Destory the file backed page. PAGE will be freed by the caller.
+ * Modified contents are written back first. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	bool locked = fs_lock ();
+
+	if (page->frame != NULL && pml4_is_dirty (page->owner->pml4, page->va))
+		file_write_at (file_page->file, page->frame->kva,
+				file_page->read_bytes, file_page->ofs);
+	file_close (file_page->file);
+	fs_unlock (locked);
 }
 
-/* Do the mmap */
+/* Adds a page like SRC, a loaded page of an mmap()ed region, to the
+ * current process, to be loaded from the same part of the file.
+ * For fork. */
+bool
+file_backed_dup (struct page *src) {
+	struct file_page *file_page = &src->file;
+	struct file_segment seg = {
+		.file = file_page->file,
+		.ofs = file_page->ofs,
+		.read_bytes = file_page->read_bytes,
+		.zero_bytes = PGSIZE - file_page->read_bytes,
+		.mapping = file_page->mapping,
+	};
+	struct file_segment *aux = file_segment_dup (&seg);
+
+	if (aux == NULL)
+		return false;
+	if (!vm_alloc_page_with_initializer (VM_FILE, src->va, src->writable,
+				file_map_load, aux)) {
+		file_segment_free (aux);
+		return false;
+	}
+	return true;
+}
+
+/* Returns the start of the mmap()ed region PAGE belongs to, or a
+ * null pointer if it is not part of one. */
+static void *
+page_mapping (struct page *page) {
+	if (page_get_type (page) != VM_FILE)
+		return NULL;
+	if (VM_TYPE (page->operations->type) == VM_UNINIT)
+		return ((struct file_segment *) page->uninit.aux)->mapping;
+	return page->file.mapping;
+}
+
+/* Do the mmap.  Maps LENGTH bytes of FILE from OFFSET at ADDR, which
+ * must be page-aligned, one lazily loaded page at a time.  Returns
+ * ADDR, or a null pointer if any page of the range is in use or
+ * memory runs out. */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	off_t file_len = file_length (file);
+	size_t page_cnt = DIV_ROUND_UP (length, PGSIZE);
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++)
+		if (spt_find_page (spt, (uint8_t *) addr + i * PGSIZE) != NULL)
+			return NULL;
+
+	for (i = 0; i < page_cnt; i++) {
+		off_t ofs = offset + i * PGSIZE;
+		size_t left = ofs < file_len ? (size_t) (file_len - ofs) : 0;
+		struct file_segment seg = {
+			.file = file,
+			.ofs = ofs,
+			.read_bytes = left < PGSIZE ? left : PGSIZE,
+			.mapping = addr,
+		};
+		struct file_segment *aux;
+
+		seg.zero_bytes = PGSIZE - seg.read_bytes;
+		aux = file_segment_dup (&seg);
+		if (aux == NULL
+				|| !vm_alloc_page_with_initializer (VM_FILE,
+					(uint8_t *) addr + i * PGSIZE, writable, file_map_load, aux)) {
+			file_segment_free (aux);
+			do_munmap (addr);
+			return NULL;
+		}
+	}
+	return addr;
 }
 
-/* Do the munmap */
+/* Do the munmap.  Unmaps the region mmap() returned as ADDR,
+ * writing back the pages that were modified. */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *mapping = addr;
+	struct page *page;
+
+	while ((page = spt_find_page (spt, addr)) != NULL
+			&& page_mapping (page) == mapping) {
+		spt_remove_page (spt, page);
+		addr = (uint8_t *) addr + PGSIZE;
+	}
 }
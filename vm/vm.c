@@ -1,8 +1,81 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <stdio.h>
+#include <string.h>
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "intrinsic.h"
+
+/* Caches of struct page and struct frame. */
+static struct kmem_cache *page_cache;
+static struct kmem_cache *frame_cache;
+
+/* Largest the user stack may grow to. */
+#define STACK_MAX (1 << 20)
+
+/* Page fault statistics.  Cycles are measured with the time stamp
+ * counter from entry to vm_try_handle_fault() until the page is
+ * mapped. */
+static unsigned long long fault_cnt;        /* Faults resolved. */
+static unsigned long long fault_stack_cnt;  /* ...of which grew the stack. */
+static unsigned long long fault_bad_cnt;    /* Faults not resolved. */
+static unsigned long long fault_cycles;     /* Total cycles of resolved faults. */
+static unsigned long long fault_max_cycles; /* Slowest resolved fault. */
+
+/* Frame table: every frame that holds a mapped user page, in the
+ * order the clock hand sweeps them.  FRAME_LOCK protects it, the
+ * hand, and the link between a frame and its page while the frame
+ * is on the table.  A frame that is being loaded or copied stays off
+ * the table, so that it cannot be evicted yet.
+ *
+ * A frame that is being written out is off the table too, and marked
+ * busy: its pages are unmapped but still point to it.  The evictor
+ * does the I/O without FRAME_LOCK, and anyone who finds a busy frame
+ * waits on EVICT_DONE until the evictor has either detached its
+ * pages or put it back. */
+static struct list frame_table;
+static struct lock frame_lock;
+static struct condition evict_done;
+static struct list_elem *clock_hand;    /* Next frame to look at. */
+
+/* Eviction statistics. */
+static unsigned long long evict_cnt;        /* Frames evicted. */
+static unsigned long long evict_write_cnt;  /* ...that had to be written out. */
+static unsigned long long evict_fail_cnt;   /* Victims that could not be. */
+static unsigned long long clock_steps;      /* Frames the hand passed over. */
+static unsigned long long evict_pass_cnt;   /* Batches evicted. */
+static unsigned long long readahead_cnt;    /* Pages swapped in ahead of a fault. */
+
+/* Copy-on-write statistics. */
+static unsigned long long cow_share_cnt;    /* Pages shared by fork(). */
+static unsigned long long cow_copy_cnt;     /* Copied on a write fault. */
+static unsigned long long cow_reuse_cnt;    /* Written by the last sharer. */
+
+/* Frames evicted at once when memory runs out.  Picking several
+ * victims in one pass takes FRAME_LOCK and sweeps the clock once for
+ * all of them, and the frames left over serve the next faults and
+ * read-ahead without another pass. */
+#define EVICT_BATCH 8
+
+/* Pages read ahead after a fault swaps a page in. */
+#define READAHEAD_PAGES 4
+
+/* A frame that is not holding a page. */
+static void
+frame_ctor (void *frame_) {
+	struct frame *frame = frame_;
+
+	frame->kva = NULL;
+	list_init (&frame->pages);
+	frame->ref_cnt = 0;
+	frame->busy = false;
+}
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -15,7 +88,12 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	page_cache = kmem_cache_create ("page", sizeof (struct page), NULL);
+	frame_cache = kmem_cache_create ("frame", sizeof (struct frame), frame_ctor);
+	list_init (&frame_table);
+	lock_init (&frame_lock);
+	cond_init (&evict_done);
+	clock_hand = list_end (&frame_table);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -33,9 +111,14 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
-static struct frame *vm_get_victim (void);
+static struct frame *vm_get_victim (bool write_files);
 static bool vm_do_claim_page (struct page *page);
-static struct frame *vm_evict_frame (void);
+static bool vm_load_page (struct page *page, bool evict);
+static void vm_swap_readahead (struct page *page);
+static struct frame *vm_wait_frame (struct page *page);
+static size_t vm_evict_frames (struct frame **victims, size_t max);
+static struct frame *vm_get_frame (enum palloc_flags flags, bool evict);
+static void vm_free_frame (struct frame *frame);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -47,144 +130,996 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 	ASSERT (VM_TYPE(type) != VM_UNINIT)
 
 	struct supplemental_page_table *spt = &thread_current ()->spt;
+	bool (*initializer) (struct page *, enum vm_type, void *);
+	struct page *page;
 
 	/* Check wheter the upage is already occupied or not. */
-	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
+	if (spt_find_page (spt, upage) != NULL)
+		goto err;
 
-		/* TODO: Insert the page into the spt. */
+	switch (VM_TYPE (type)) {
+		case VM_ANON:
+			initializer = anon_initializer;
+			break;
+		case VM_FILE:
+			initializer = file_backed_initializer;
+			break;
+		default:
+			goto err;
 	}
+
+	page = kmem_cache_alloc (page_cache);
+	if (page == NULL)
+		goto err;
+	uninit_new (page, pg_round_down (upage), init, type, aux, initializer);
+	page->writable = writable;
+	page->owner = thread_current ();
+
+	if (!spt_insert_page (spt, page)) {
+		kmem_cache_free (page_cache, page);
+		goto err;
+	}
+	return true;
 err:
 	return false;
 }
 
-/* Find VA from spt and return page. On error, return NULL. */
+#ifdef SPT_RADIX
+/* The SPT is a radix tree shaped like the x86-64 page table: four
+ * levels of 512-entry nodes, indexed by the same bits of va as the
+ * PML4, page directory pointer table, page directory and page table.
+ * Entries of the last level point to struct page.  A node is
+ * allocated when the first page below it is inserted, so a dense
+ * region costs one pointer per page, and walks skip empty subtrees.
+ * Nodes are only freed by supplemental_page_table_kill(). */
+#define SPT_LEVELS 4
+#define SPT_FANOUT 512
+
+/* va shift of each level, leaf first. */
+static const unsigned spt_shift[SPT_LEVELS] = {
+	PTXSHIFT, PDXSHIFT, PDPESHIFT, PML4SHIFT
+};
+
+static size_t spt_node_cnt;     /* Nodes allocated, in all SPTs. */
+
+/* Initialize new supplemental page table */
+void
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	spt->root = NULL;
+}
+
+/* Returns the entry for VA in SPT's leaf node.  If that node does
+ * not exist, returns a null pointer, unless CREATE is true, in which
+ * case the missing nodes are allocated; if that fails, returns a
+ * null pointer. */
+static struct page **
+spt_slot (struct supplemental_page_table *spt, const void *va, bool create) {
+	void **link = (void **) &spt->root;
+	int level;
+
+	for (level = SPT_LEVELS - 1; ; level--) {
+		void **node = *link;
+
+		if (node == NULL) {
+			if (!create)
+				return NULL;
+			node = palloc_get_page (PAL_ZERO);
+			if (node == NULL)
+				return NULL;
+			spt_node_cnt++;
+			*link = node;
+		}
+		link = &node[((uint64_t) va >> spt_shift[level]) & (SPT_FANOUT - 1)];
+		if (level == 0)
+			return (struct page **) link;
+	}
+}
+
+/* Find VA from spt and return page. On error, return NULL.
+ * Runs in the page fault path, so it must not allocate. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page **slot = spt_slot (spt, va, false);
 
-	return page;
+	return slot != NULL ? *slot : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
+spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
+	struct page **slot;
 
-	return succ;
+	ASSERT (pg_ofs (page->va) == 0);
+
+	slot = spt_slot (spt, page->va, true);
+	if (slot == NULL || *slot != NULL)
+		return false;
+	*slot = page;
+	return true;
 }
 
+/* Remove PAGE from spt and free it. */
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	struct page **slot = spt_slot (spt, page->va, false);
+
+	ASSERT (slot != NULL && *slot == page);
+	*slot = NULL;
 	vm_dealloc_page (page);
+}
+
+/* Calls FUNC for each page below NODE, a node of LEVEL. */
+static bool
+spt_walk (void **node, int level, spt_for_each_func *func, void *aux) {
+	int i;
+
+	for (i = 0; i < SPT_FANOUT; i++) {
+		if (node[i] == NULL)
+			continue;
+		if (level == 0 ? !func (node[i], aux)
+				: !spt_walk (node[i], level - 1, func, aux))
+			return false;
+	}
 	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
-static struct frame *
-vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+/* Calls FUNC for each page in SPT, in increasing order of va, and
+ * stops as soon as FUNC returns false.  Returns true if FUNC
+ * returned true for every page.  FUNC must not insert or remove
+ * pages. */
+bool
+spt_for_each (struct supplemental_page_table *spt,
+		spt_for_each_func *func, void *aux) {
+	if (spt->root == NULL)
+		return true;
+	return spt_walk (spt->root, SPT_LEVELS - 1, func, aux);
+}
+
+/* Frees NODE, a node of LEVEL, and every page below it. */
+static void
+spt_destroy_node (void **node, int level) {
+	int i;
+
+	for (i = 0; i < SPT_FANOUT; i++) {
+		if (node[i] == NULL)
+			continue;
+		if (level == 0)
+			vm_dealloc_page (node[i]);
+		else
+			spt_destroy_node (node[i], level - 1);
+	}
+	palloc_free_page (node);
+	spt_node_cnt--;
+}
+
+/* Free the resource hold by the supplemental page table */
+void
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	if (spt->root != NULL)
+		spt_destroy_node (spt->root, SPT_LEVELS - 1);
+	spt->root = NULL;
+}
+
+#else /* !SPT_RADIX */
+/* Returns a hash value for page P. */
+static uint64_t
+page_hash (const struct hash_elem *p_, void *aux UNUSED) {
+	const struct page *p = hash_entry (p_, struct page, spt_elem);
+	return hash_bytes (&p->va, sizeof p->va);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_,
+		const struct hash_elem *b_, void *aux UNUSED) {
+	const struct page *a = hash_entry (a_, struct page, spt_elem);
+	const struct page *b = hash_entry (b_, struct page, spt_elem);
+
+	return a->va < b->va;
+}
+
+/* Initialize new supplemental page table */
+void
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	if (!hash_init (&spt->pages, page_hash, page_less, NULL))
+		PANIC ("supplemental_page_table_init: out of memory");
+}
+
+/* Find VA from spt and return page. On error, return NULL.
+ * Runs in the page fault path, so it must not allocate: the key
+ * lives on the stack. */
+struct page *
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page key;
+	struct hash_elem *e;
+
+	key.va = pg_round_down (va);
+	e = hash_find (&spt->pages, &key.spt_elem);
+	return e != NULL ? hash_entry (e, struct page, spt_elem) : NULL;
+}
+
+/* Insert PAGE into spt with validation. */
+bool
+spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
+	ASSERT (pg_ofs (page->va) == 0);
+
+	return hash_insert (&spt->pages, &page->spt_elem) == NULL;
+}
+
+/* Remove PAGE from spt and free it. */
+void
+spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (&spt->pages, &page->spt_elem);
+	vm_dealloc_page (page);
+}
+
+/* Calls FUNC for each page in SPT, in no particular order, and
+ * stops as soon as FUNC returns false.  Returns true if FUNC
+ * returned true for every page.  FUNC must not insert or remove
+ * pages. */
+bool
+spt_for_each (struct supplemental_page_table *spt,
+		spt_for_each_func *func, void *aux) {
+	struct hash_iterator i;
+
+	hash_first (&i, &spt->pages);
+	while (hash_next (&i))
+		if (!func (hash_entry (hash_cur (&i), struct page, spt_elem), aux))
+			return false;
+	return true;
+}
+
+/* Frees the page behind E, for hash_destroy(). */
+static void
+spt_destroy_page (struct hash_elem *e, void *aux UNUSED) {
+	vm_dealloc_page (hash_entry (e, struct page, spt_elem));
+}
+
+/* Free the resource hold by the supplemental page table */
+void
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	hash_destroy (&spt->pages, spt_destroy_page);
+}
+#endif /* SPT_RADIX */
+
+/* Puts FRAME on the frame table just behind the clock hand, so that
+ * it is the last frame the hand reaches.  FRAME_LOCK must be held. */
+static void
+frame_table_insert (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	list_insert (clock_hand, &frame->elem);
+}
+
+/* Takes FRAME off the frame table.  FRAME_LOCK must be held. */
+static void
+frame_table_remove (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	if (clock_hand == &frame->elem)
+		clock_hand = list_next (clock_hand);
+	list_remove (&frame->elem);
+}
+
+/* Returns true if PAGE can be evicted without I/O: it is backed by
+ * a file or a swap slot that already holds its contents. */
+static bool
+page_is_clean (struct page *page) {
+	switch (page_get_type (page)) {
+		case VM_FILE:
+			break;
+		case VM_ANON:
+			if (page->anon.slot == SWAP_SLOT_NONE)
+				return false;
+			break;
+		default:
+			return false;
+	}
+	return !pml4_is_dirty (page->owner->pml4, page->va);
+}
+
+/* Adds PAGE to the pages that map FRAME.  FRAME_LOCK must be held
+ * if FRAME is on the frame table. */
+static void
+frame_add_page (struct frame *frame, struct page *page) {
+	list_push_back (&frame->pages, &page->frame_elem);
+	frame->ref_cnt++;
+	page->frame = frame;
+}
+
+/* Removes PAGE from the pages that map FRAME.  FRAME_LOCK must be
+ * held if FRAME is on the frame table. */
+static void
+frame_remove_page (struct frame *frame, struct page *page) {
+	ASSERT (page->frame == frame);
+	list_remove (&page->frame_elem);
+	frame->ref_cnt--;
+}
+
+/* Returns the page of FRAME that is swapped out on behalf of all of
+ * them: one that already has a swap slot, if any does. */
+static struct page *
+frame_primary (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		if (page_get_type (page) == VM_ANON
+				&& page->anon.slot != SWAP_SLOT_NONE)
+			return page;
+	}
+	return list_entry (list_front (&frame->pages), struct page, frame_elem);
+}
+
+/* Returns true if any page of FRAME was accessed since the clock
+ * hand last passed, and clears their accessed bits. */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	struct list_elem *e;
+	bool accessed = false;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Returns true if any page of FRAME is dirty. */
+static bool
+frame_is_dirty (struct frame *frame) {
+	struct list_elem *e;
 
-	return victim;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		if (pml4_is_dirty (page->owner->pml4, page->va))
+			return true;
+	}
+	return false;
+}
+
+/* Returns true if FRAME can be evicted without I/O. */
+static bool
+frame_is_clean (struct frame *frame) {
+	return page_is_clean (frame_primary (frame)) && !frame_is_dirty (frame);
 }
 
-/* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+/* Get the struct frame, that will be evicted.
+ *
+ * Second-chance clock: the hand sweeps the frame table, and a frame
+ * that was accessed since the hand last passed has its accessed bits
+ * cleared and is passed over.  For the first two laps the hand also
+ * passes over frames that would need I/O, so that a clean one, which
+ * is simply dropped, is preferred.  In the third lap a dirty
+ * file-backed page will do, since writing it back to its file is
+ * needed sooner or later anyway.  After that, any frame not accessed
+ * will do.  Dirty file-backed frames are passed over altogether
+ * unless WRITE_FILES, that is, unless the caller holds
+ * filesys_lock to write them back with.  FRAME_LOCK must be held. */
 static struct frame *
-vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+vm_get_victim (bool write_files) {
+	size_t frame_cnt = list_size (&frame_table);
+	size_t i;
+
+	for (i = 0; i < 4 * frame_cnt; i++) {
+		struct frame *frame;
 
+		if (clock_hand == list_end (&frame_table))
+			clock_hand = list_begin (&frame_table);
+		frame = list_entry (clock_hand, struct frame, elem);
+		clock_hand = list_next (clock_hand);
+		clock_steps++;
+
+		if (frame_test_and_clear_accessed (frame))
+			continue;
+		if (frame_is_clean (frame))
+			return frame;
+		if (i < 2 * frame_cnt)
+			continue;
+		if (page_get_type (frame_primary (frame)) == VM_FILE
+				? !write_files : i < 3 * frame_cnt)
+			continue;
+		return frame;
+	}
 	return NULL;
 }
 
-/* palloc() and get frame. If there is no available page, evict the page
- * and return it. This always return valid address. That is, if the user pool
- * memory is full, this function evicts the frame to get the available memory
- * space.*/
+/* Returns PAGE's frame, or a null pointer if PAGE is not in
+ * memory, after waiting for an eviction of the frame that is under
+ * way to finish.  FRAME_LOCK must be held. */
+static struct frame *
+vm_wait_frame (struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	while (page->frame != NULL && page->frame->busy)
+		cond_wait (&evict_done, &frame_lock);
+	return page->frame;
+}
+
+/* Unmaps the pages of VICTIM, so that their owners cannot change
+ * them while it is written out, and marks it busy.  If an owner
+ * touches its page, it will fault and wait for the eviction.
+ * Unmapping keeps the dirty bits, and the primary page has to be
+ * written if any of the pages is dirty.  Returns whether one was.
+ * FRAME_LOCK must be held. */
+static bool
+evict_begin (struct frame *victim) {
+	struct page *primary = frame_primary (victim);
+	bool dirty = frame_is_dirty (victim);
+	struct list_elem *e;
+
+	for (e = list_begin (&victim->pages); e != list_end (&victim->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		pml4_clear_page (page->owner->pml4, page->va);
+	}
+	if (dirty)
+		pml4_set_dirty (primary->owner->pml4, primary->va, true);
+	frame_table_remove (victim);
+	victim->busy = true;
+	return dirty;
+}
+
+/* Maps the pages of VICTIM again after it could not be written out,
+ * and puts it back on the frame table.  FRAME_LOCK must be held. */
+static void
+evict_abort (struct frame *victim) {
+	struct list_elem *e;
+
+	for (e = list_begin (&victim->pages); e != list_end (&victim->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		uint64_t *pml4 = page->owner->pml4;
+		bool page_dirty = pml4_is_dirty (pml4, page->va);
+
+		pml4_set_page (pml4, page->va, victim->kva,
+				page->writable && victim->ref_cnt == 1);
+		pml4_set_dirty (pml4, page->va, page_dirty);
+	}
+	victim->busy = false;
+	frame_table_insert (victim);
+}
+
+/* Detaches the pages of VICTIM, which PRIMARY was written out for.
+ * The other pages share PRIMARY's swap slot.  FRAME_LOCK must be
+ * held. */
+static void
+evict_finish (struct frame *victim, struct page *primary) {
+	while (!list_empty (&victim->pages)) {
+		struct page *page = list_entry (list_front (&victim->pages),
+				struct page, frame_elem);
+
+		if (page != primary) {
+			ASSERT (VM_TYPE (page->operations->type) == VM_ANON);
+			anon_share_slot (page, primary);
+		}
+		frame_remove_page (victim, page);
+		page->frame = NULL;
+	}
+	victim->busy = false;
+}
+
+/* Evicts up to MAX frames and stores them, no longer on the frame
+ * table, in VICTIMS.  Returns the number of frames evicted, which is
+ * 0 if none could be.
+ *
+ * The victims are picked and unmapped with FRAME_LOCK held, written
+ * out without it, so that other faults need not wait for the disk,
+ * and then detached from their pages, or put back if they could not
+ * be written, with FRAME_LOCK held again.
+ *
+ * A frame shared copy-on-write is written out once, through its
+ * primary page, and the other pages share that page's swap slot.
+ * Only anonymous pages are ever shared.
+ *
+ * Dirty file-backed pages are written back with filesys_lock held,
+ * since the file system does no locking of its own.  A thread that
+ * holds filesys_lock may fault on one of the victims and wait for
+ * the eviction, so filesys_lock is never waited for once victims are
+ * picked.  It is only tried for beforehand, and if it is busy, dirty
+ * file-backed frames are left alone.  Only if nothing else can be
+ * evicted do we wait for it, holding no victims yet. */
+static size_t
+vm_evict_frames (struct frame **victims, size_t max) {
+	struct page *primaries[EVICT_BATCH];
+	bool dirty[EVICT_BATCH], written[EVICT_BATCH];
+	bool fs_held = lock_held_by_current_thread (&filesys_lock);
+	bool fs_locked = !fs_held && lock_try_acquire (&filesys_lock);
+	size_t picked = 0, cnt = 0, i;
+
+	ASSERT (max <= EVICT_BATCH);
+
+	lock_acquire (&frame_lock);
+	while (picked < max) {
+		struct frame *victim = vm_get_victim (fs_held || fs_locked);
+
+		if (victim == NULL && picked == 0 && !fs_held && !fs_locked) {
+			lock_release (&frame_lock);
+			lock_acquire (&filesys_lock);
+			fs_locked = true;
+			lock_acquire (&frame_lock);
+			continue;
+		}
+		if (victim == NULL)
+			break;
+		victims[picked] = victim;
+		primaries[picked] = frame_primary (victim);
+		dirty[picked] = evict_begin (victim);
+		picked++;
+	}
+	lock_release (&frame_lock);
+
+	for (i = 0; i < picked; i++)
+		written[i] = swap_out (primaries[i]);
+	if (fs_locked)
+		lock_release (&filesys_lock);
+
+	lock_acquire (&frame_lock);
+	for (i = 0; i < picked; i++) {
+		if (!written[i]) {
+			evict_abort (victims[i]);
+			evict_fail_cnt++;
+			continue;
+		}
+		evict_finish (victims[i], primaries[i]);
+		evict_cnt++;
+		evict_write_cnt += dirty[i];
+		victims[cnt++] = victims[i];
+	}
+	if (cnt > 0)
+		evict_pass_cnt++;
+	cond_broadcast (&evict_done, &frame_lock);
+	lock_release (&frame_lock);
+	return cnt;
+}
+
+/* palloc() and get frame. If there is no available page and EVICT
+ * is true, evict a batch of pages, keep the first frame and free the
+ * rest.  Returns a null pointer if no frame can be had.  The frame
+ * is not on the frame table yet. */
 static struct frame *
-vm_get_frame (void) {
-	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+vm_get_frame (enum palloc_flags flags, bool evict) {
+	struct frame *frame;
+	void *kva = palloc_get_page (PAL_USER | flags);
+
+	if (kva != NULL) {
+		frame = kmem_cache_alloc (frame_cache);
+		if (frame == NULL) {
+			palloc_free_page (kva);
+			return NULL;
+		}
+		frame->kva = kva;
+	} else if (evict) {
+		struct frame *victims[EVICT_BATCH];
+		size_t cnt = vm_evict_frames (victims, EVICT_BATCH);
+		size_t i;
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+		if (cnt == 0)
+			return NULL;
+		for (i = 1; i < cnt; i++)
+			vm_free_frame (victims[i]);
+		frame = victims[0];
+		if (flags & PAL_ZERO)
+			memset (frame->kva, 0, PGSIZE);
+	} else
+		return NULL;
+
+	ASSERT (list_empty (&frame->pages));
 	return frame;
 }
 
-/* Growing the stack. */
+/* Frees FRAME and the memory it holds.  The page it held must
+ * already be unmapped. */
 static void
-vm_stack_growth (void *addr UNUSED) {
+vm_free_frame (struct frame *frame) {
+	ASSERT (list_empty (&frame->pages));
+	ASSERT (!frame->busy);
+	palloc_free_page (frame->kva);
+	frame->kva = NULL;
+	kmem_cache_free (frame_cache, frame);
 }
 
-/* Handle the fault on write_protected page */
+/* Returns true if a fault at ADDR, with the user stack pointer at
+ * RSP, looks like a stack access: at most 8 bytes below RSP (PUSH
+ * faults before it moves RSP) and within STACK_MAX of USER_STACK. */
+bool
+vm_is_stack_access (const void *addr, const void *rsp) {
+	return (uint8_t *) addr >= (uint8_t *) rsp - 8
+		&& (uint8_t *) addr < (uint8_t *) USER_STACK
+		&& (uint8_t *) addr >= (uint8_t *) USER_STACK - STACK_MAX;
+}
+
+/* Growing the stack. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_stack_growth (void *addr) {
+	return vm_alloc_page (VM_ANON | VM_STACK, pg_round_down (addr), true);
+}
+
+/* Handle the fault on write_protected page.  A writable page is
+ * write-protected while it shares its frame copy-on-write.  The
+ * writer gets a copy of the frame, unless it is the last page left
+ * on it, which takes the frame over. */
+static bool
+vm_handle_wp (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+	struct frame *frame, *copy;
+
+	if (!page->writable)
+		return false;
+
+	lock_acquire (&frame_lock);
+	frame = vm_wait_frame (page);
+	if (frame == NULL) {
+		/* Evicted while we waited: the write will fault again and
+		 * swap in a frame of its own. */
+		lock_release (&frame_lock);
+		return true;
+	}
+	if (frame->ref_cnt == 1) {
+		pml4_set_writable (pml4, page->va, true);
+		cow_reuse_cnt++;
+		lock_release (&frame_lock);
+		return true;
+	}
+	lock_release (&frame_lock);
+
+	/* Getting a frame may evict, so do it before taking FRAME_LOCK
+	 * again, and check what became of PAGE meanwhile. */
+	copy = vm_get_frame (0, true);
+	if (copy == NULL)
+		return false;
+
+	lock_acquire (&frame_lock);
+	frame = vm_wait_frame (page);
+	if (frame == NULL) {
+		/* Evicted: the write will fault again and swap in a frame
+		 * of its own. */
+		lock_release (&frame_lock);
+		vm_free_frame (copy);
+		return true;
+	}
+	if (frame->ref_cnt == 1) {
+		pml4_set_writable (pml4, page->va, true);
+		cow_reuse_cnt++;
+		lock_release (&frame_lock);
+		vm_free_frame (copy);
+		return true;
+	}
+
+	memcpy (copy->kva, frame->kva, PGSIZE);
+	frame_remove_page (frame, page);
+	frame_add_page (copy, page);
+	pml4_set_page (pml4, page->va, copy->kva, true);
+	frame_table_insert (copy);
+	cow_copy_cnt++;
+	lock_release (&frame_lock);
+	return true;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
-	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	struct thread *curr = thread_current ();
+	struct supplemental_page_table *spt = &curr->spt;
+	uint64_t start = rdtsc ();
+	bool stack = false;
+	struct page *page;
+	uint64_t cycles;
 
-	return vm_do_claim_page (page);
+	/* Validate the fault. */
+	if (addr == NULL || !is_user_vaddr (addr))
+		goto bad;
+
+	page = spt_find_page (spt, addr);
+	if (page == NULL) {
+		/* In a system call F is the kernel's frame, so use the
+		 * stack pointer saved on entry. */
+		void *rsp = user ? (void *) f->rsp : curr->user_rsp;
+
+		if (!vm_is_stack_access (addr, rsp) || !vm_stack_growth (addr))
+			goto bad;
+		page = spt_find_page (spt, addr);
+		stack = true;
+	}
+
+	if (!not_present) {
+		if (!write || !vm_handle_wp (page))
+			goto bad;
+	} else if ((write && !page->writable) || !vm_do_claim_page (page))
+		goto bad;
+
+	/* Read-ahead is not part of this fault's latency, so stop the
+	 * clock before it. */
+	cycles = rdtsc () - start;
+	fault_cnt++;
+	fault_stack_cnt += stack;
+	fault_cycles += cycles;
+	if (cycles > fault_max_cycles)
+		fault_max_cycles = cycles;
+
+	if (not_present)
+		vm_swap_readahead (page);
+	return true;
+
+bad:
+	fault_bad_cnt++;
+	return false;
 }
 
-/* Free the page.
- * DO NOT MODIFY THIS FUNCTION. */
+/* Free the page.  Its frame, if any, is unmapped from the current
+ * process and freed too. */
 void
 vm_dealloc_page (struct page *page) {
+	struct frame *frame;
+
+	/* Take PAGE off its frame first.  If it was the last page there,
+	 * take the frame off the table as well, so that it is not evicted
+	 * while PAGE is being destroyed.  Otherwise the frame is left to
+	 * the pages still sharing it.  A frame that is being written out
+	 * has to be finished with first. */
+	lock_acquire (&frame_lock);
+	frame = vm_wait_frame (page);
+	if (frame != NULL) {
+		frame_remove_page (frame, page);
+		if (frame->ref_cnt == 0)
+			frame_table_remove (frame);
+		else {
+			page->frame = NULL;
+			pml4_clear_page (page->owner->pml4, page->va);
+			frame = NULL;
+		}
+	}
+	lock_release (&frame_lock);
+
 	destroy (page);
-	free (page);
+	if (frame != NULL) {
+		pml4_clear_page (page->owner->pml4, page->va);
+		vm_free_frame (frame);
+	}
+	kmem_cache_free (page_cache, page);
 }
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+vm_claim_page (void *va) {
+	struct page *page = spt_find_page (&thread_current ()->spt, va);
 
+	if (page == NULL)
+		return false;
 	return vm_do_claim_page (page);
 }
 
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	bool resident;
+
+	/* If PAGE is being evicted, wait for that to finish.  If it could
+	 * not be, it is back in memory already. */
+	lock_acquire (&frame_lock);
+	resident = vm_wait_frame (page) != NULL;
+	lock_release (&frame_lock);
+	if (resident)
+		return true;
+
+	if (!vm_load_page (page, true))
+		return false;
+
+	lock_acquire (&frame_lock);
+	frame_table_insert (page->frame);
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Loads PAGE into a new frame and maps it, but leaves the frame off
+ * the frame table, so that the caller can finish with it before it
+ * may be evicted.  Evicts other pages for the frame only if EVICT is
+ * true. */
+static bool
+vm_load_page (struct page *page, bool evict) {
+	/* A fresh anonymous page without an initializer must read as
+	 * zeros; let the allocator hand out a pre-zeroed page. */
+	bool zero = VM_TYPE (page->operations->type) == VM_UNINIT
+		&& page->uninit.init == NULL;
+	struct frame *frame = vm_get_frame (zero ? PAL_ZERO : 0, evict);
+
+	if (frame == NULL)
+		return false;
 
 	/* Set links */
-	frame->page = page;
-	page->frame = frame;
+	frame_add_page (frame, page);
+
+	if (!swap_in (page, frame->kva))
+		goto fail;
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+	/* Insert page table entry to map page's VA to frame's PA. */
+	if (!pml4_set_page (page->owner->pml4, page->va, frame->kva,
+				page->writable))
+		goto fail;
+	return true;
 
-	return swap_in (page, frame->kva);
+fail:
+	frame_remove_page (frame, page);
+	page->frame = NULL;
+	vm_free_frame (frame);
+	return false;
 }
 
-/* Initialize new supplemental page table */
-void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+/* After a fault on PAGE, swaps in the pages that follow it, as long
+ * as they are anonymous, swapped out, and sit in the following swap
+ * slots, so that a process walking through swapped-out memory does
+ * not fault on every page.  Only free frames are used, such as those
+ * left over from the last batch of evictions: reading ahead is not
+ * worth evicting for. */
+static void
+vm_swap_readahead (struct page *page) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	size_t slot;
+	void *va;
+	int i;
+
+	if (VM_TYPE (page->operations->type) != VM_ANON
+			|| page->anon.slot == SWAP_SLOT_NONE)
+		return;
+
+	slot = page->anon.slot;
+	va = page->va;
+	for (i = 0; i < READAHEAD_PAGES; i++) {
+		struct page *next;
+		bool swapped;
+
+		slot++;
+		va += PGSIZE;
+		next = spt_find_page (spt, va);
+		if (next == NULL || VM_TYPE (next->operations->type) != VM_ANON)
+			break;
+
+		/* NEXT's slot only changes while it is being evicted, and
+		 * then its frame is busy rather than null.  Do not wait for
+		 * such a page: it is not worth reading ahead. */
+		lock_acquire (&frame_lock);
+		swapped = next->frame == NULL && next->anon.slot == slot;
+		lock_release (&frame_lock);
+		if (!swapped || !vm_load_page (next, false))
+			break;
+
+		lock_acquire (&frame_lock);
+		frame_table_insert (next->frame);
+		lock_release (&frame_lock);
+		readahead_cnt++;
+	}
+}
+
+/* Shares SRC, a loaded anonymous page of the parent, with the
+ * current process copy-on-write.  If SRC is in memory, both pages
+ * map its frame read-only until one of them writes to it.  If it is
+ * swapped out, they share its swap slot instead. */
+static bool
+spt_share_page (struct page *src) {
+	struct frame *frame;
+	struct page *dst;
+
+	if (!vm_alloc_page (page_get_type (src), src->va, src->writable))
+		return false;
+	dst = spt_find_page (&thread_current ()->spt, src->va);
+
+	/* Turn DST into an anonymous page.  With no init function, its
+	 * initializer does not touch the frame, so it is run without one. */
+	if (!swap_in (dst, NULL))
+		return false;
+
+	lock_acquire (&frame_lock);
+	frame = vm_wait_frame (src);
+	if (frame == NULL)
+		anon_share_slot (dst, src);
+	else if (!pml4_set_page (dst->owner->pml4, dst->va, frame->kva, false)) {
+		lock_release (&frame_lock);
+		return false;
+	} else {
+		frame_add_page (frame, dst);
+		pml4_set_writable (src->owner->pml4, src->va, false);
+	}
+	cow_share_cnt++;
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Copies one page of the parent, SRC, into the current process.
+ * Pages that have not been loaded yet stay that way, with their
+ * own copy of the segment to load from.  Loaded anonymous pages are
+ * shared copy-on-write, and loaded file-backed pages are copied
+ * into new frames. */
+static bool
+spt_copy_page (struct page *src, void *aux UNUSED) {
+	struct file_segment *seg = NULL;
+	struct frame *frame;
+	struct page *dst;
+	bool success;
+
+	if (VM_TYPE (src->operations->type) == VM_UNINIT) {
+		if (src->uninit.aux != NULL) {
+			seg = file_segment_dup (src->uninit.aux);
+			if (seg == NULL)
+				return false;
+		}
+		if (!vm_alloc_page_with_initializer (src->uninit.type, src->va,
+					src->writable, src->uninit.init, seg)) {
+			file_segment_free (seg);
+			return false;
+		}
+		return true;
+	}
+
+	if (page_get_type (src) == VM_ANON)
+		return spt_share_page (src);
+
+	if (!file_backed_dup (src))
+		return false;
+	dst = spt_find_page (&thread_current ()->spt, src->va);
+
+	/* Keep SRC in memory while it is copied by taking its frame off
+	 * the frame table, where the clock hand cannot find it. */
+	lock_acquire (&frame_lock);
+	frame = vm_wait_frame (src);
+	if (frame != NULL)
+		frame_table_remove (frame);
+	lock_release (&frame_lock);
+
+	/* A file-backed page was written back when it was evicted, so
+	 * DST can load it from the file. */
+	if (frame == NULL)
+		return true;
+
+	success = vm_load_page (dst, true);
+	if (success) {
+		memcpy (dst->frame->kva, frame->kva, PGSIZE);
+		if (pml4_is_dirty (src->owner->pml4, src->va))
+			pml4_set_dirty (dst->owner->pml4, dst->va, true);
+	}
+
+	lock_acquire (&frame_lock);
+	frame_table_insert (frame);
+	if (success)
+		frame_table_insert (dst->frame);
+	lock_release (&frame_lock);
+	return success;
 }
 
 /* Copy supplemental page table from src to dst */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	ASSERT (dst == &thread_current ()->spt);
+
+	return spt_for_each (src, spt_copy_page, NULL);
 }
 
-/* Free the resource hold by the supplemental page table */
+/* Prints page fault and SPT statistics. */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
+vm_print_stats (void) {
+#ifdef SPT_RADIX
+	printf ("SPT: radix tree, %zu nodes in use\n", spt_node_cnt);
+#else
+	printf ("SPT: hash table\n");
+#endif
+	printf ("Page faults: %llu resolved (%llu stack growth), %llu not\n",
+			fault_cnt, fault_stack_cnt, fault_bad_cnt);
+	if (fault_cnt > 0)
+		printf ("Page fault latency: %llu cycles average, %llu max\n",
+				fault_cycles / fault_cnt, fault_max_cycles);
+	printf ("Frames: %llu evicted (%llu written out) in %llu passes, "
+			"%llu not evictable, clock hand moved %llu\n",
+			evict_cnt, evict_write_cnt, evict_pass_cnt, evict_fail_cnt,
+			clock_steps);
+	anon_print_stats ();
+	printf ("Swap read-ahead: %llu pages\n", readahead_cnt);
+	printf ("Copy-on-write: %llu pages shared by fork, %llu copied, "
+			"%llu taken over by the last sharer\n",
+			cow_share_cnt, cow_copy_cnt, cow_reuse_cnt);
 }